@@ -0,0 +1,269 @@
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "mapfile.h"
+#include "searchpool.h"
+#include "strategy.h"
+
+//! default corpus used by the bench-search target
+#define DEFAULT_CORPUS "data/bench/positions"
+
+//! number of self-play games sampled on each map by -generate
+#define GAMES_PER_MAP 7
+
+//! self-play games longer than this are cut (jumps can loop forever)
+#define MAX_PLIES 300
+
+//! a position of the corpus
+struct benchPosition {
+    string map;
+    //! o(pening), m(iddlegame) or e(ndgame)
+    char phase;
+    Uint16 player;
+    bidiarray<Sint16> blobs;
+};
+
+static bool loadCorpus(const string& filename, vector<benchPosition>& corpus) {
+    ifstream infile(filename.c_str(), ios::in);
+    if (!infile) {
+        cerr << "unable to open corpus " << filename << endl;
+        return false;
+    }
+
+    string line;
+    while (getline(infile, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        istringstream fields(line);
+        benchPosition p;
+        string blobs;
+        fields >> p.map >> p.phase >> p.player >> blobs;
+        if (!fields || blobs.size() != 64) {
+            cerr << "malformed corpus line: " << line << endl;
+            return false;
+        }
+        p.blobs = bidiarray<Sint16>::deserialize(blobs);
+        corpus.push_back(p);
+    }
+    return true;
+}
+
+//! returns the holes of map, loading each map only once
+static const bidiarray<bool>* getHoles(map<string, bidiarray<bool>>& maps,
+                                       const string& name) {
+    auto it = maps.find(name);
+    if (it == maps.end()) {
+        bidiarray<bool> holes;
+        if (!loadMap(MAPS_DIRECTORY + name, holes)) {
+            cerr << "unable to load map " << name << endl;
+            return NULL;
+        }
+        it = maps.insert(make_pair(name, holes)).first;
+    }
+    return &it->second;
+}
+
+/**
+ * Plays GAMES_PER_MAP seeded self-play games on every map and keeps one
+ * opening, one middlegame and one endgame position of each game.
+ * Moves are drawn among the three first moves of computeValidMoves (those
+ * gaining the most blobs) so that games differ.
+ */
+static int generateCorpus(const string& filename) {
+    ofstream outfile(filename.c_str(), ios::out);
+    if (!outfile) {
+        cerr << "unable to write corpus " << filename << endl;
+        return 1;
+    }
+    outfile << "# blobwar search corpus, generated by ./benchSearch -generate"
+            << endl;
+    outfile << "# map phase(o/m/e) player blobs" << endl;
+
+    vector<string> maps = listMaps();
+    for (Uint32 m = 0; m < maps.size(); ++m) {
+        bidiarray<bool> holes;
+        if (!loadMap(MAPS_DIRECTORY + maps[m], holes)) {
+            cerr << "unable to load map " << maps[m] << endl;
+            return 1;
+        }
+
+        for (Uint32 game = 0; game < GAMES_PER_MAP; ++game) {
+            default_random_engine rng(m * GAMES_PER_MAP + game);
+
+            bidiarray<Sint16> blobs;
+            initialBlobs(blobs);
+
+            SearchContext context;
+            Strategy s(blobs, holes, 0, context);
+            s.setSeed(rng());
+            s.initializeScores();
+
+            // every position in which the player to move has a move
+            vector<pair<string, Uint16>> history;
+            bool passed = false;
+            for (Uint32 ply = 0; ply < MAX_PLIES; ++ply) {
+                vector<movement> validMoves;
+                s.computeValidMoves(validMoves);
+                if (validMoves.empty()) {
+                    if (passed) {
+                        break;
+                    }
+                    passed = true;
+                    s.switchPlayer();
+                    continue;
+                }
+                passed = false;
+
+                s.getBlobs(blobs);
+                history.push_back(
+                    make_pair(blobs.serialize(), s.currentPlayer()));
+
+                Uint32 choices = min<Uint32>(validMoves.size(), 3);
+                s.applyMove(validMoves[rng() % choices]);
+                s.switchPlayer();
+            }
+
+            if (history.empty()) {
+                continue;
+            }
+            Uint32 n = history.size();
+            Uint32 samples[3] = {min(2 + game % 6, n - 1),
+                                 n / 2,
+                                 n - 1 - min(1 + game % 5, n - 1)};
+            const char phases[3] = {'o', 'm', 'e'};
+            for (Uint8 i = 0; i < 3; ++i) {
+                outfile << maps[m] << ' ' << phases[i] << ' '
+                        << history[samples[i]].second << ' '
+                        << history[samples[i]].first << endl;
+            }
+        }
+    }
+    return 0;
+}
+
+/** Main of benchSearch
+ * Runs computeBestMove at fixed depths on every position of a corpus and
+ * reports nodes, nodes/sec, time-to-depth, effective branching factor and
+ * the best move of each position.
+ * Each position is searched with its own seed, so two runs of the same
+ * build visit the same trees: the final signature only changes when the
+ * search itself changes.
+ */
+int main(int argc, char** argv) {
+    Uint32 depth = 2;
+    string corpusname = DEFAULT_CORPUS;
+
+    EngineConfig config;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-generate") == 0 && i + 1 < argc) {
+            return generateCorpus(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            corpusname = argv[i];
+        } else if (i + 1 >= argc ||
+                   !setEngineOption(config, argv[i] + 1, argv[i + 1])) {
+            printf("usage: ./benchSearch [-d depth] [options] [corpus]\n");
+            printf("       ./benchSearch -generate corpus\n");
+            printf("	-d <depth> search depth (default: 2).\n");
+            printf("	-generate <corpus> write a new corpus.\n");
+            printf("	engine options (-depth and -time are ignored):\n");
+            displayEngineUsage();
+            return 1;
+        } else {
+            ++i;
+        }
+    }
+    // the bench drives the depth itself
+    config.time = 0;
+    TranspositionTable table(config.ttSize);
+    PatternEvaluator patterns;
+    const PatternEvaluator* evaluator = loadEvaluator(config, patterns);
+    NetworkEvaluator weights;
+    const NetworkEvaluator* network = loadNetwork(config, weights);
+    SearchPool pool(config.threads, config.affinity);
+    if (depth == 0) {
+        depth = 1;
+    }
+
+    vector<benchPosition> corpus;
+    if (!loadCorpus(corpusname, corpus)) {
+        return 1;
+    }
+    map<string, bidiarray<bool>> maps;
+
+    cout << "# position map phase nodes time-to-depth(ms) ebf best-move"
+         << endl;
+
+    Uint64 totalNodes = 0;
+    double totalTime = 0;
+    double totalEbf = 0;
+    Uint64 signature = 14695981039346656037ULL;
+
+    for (Uint32 i = 0; i < corpus.size(); ++i) {
+        benchPosition& p = corpus[i];
+        const bidiarray<bool>* holes = getHoles(maps, p.map);
+        if (holes == NULL) {
+            return 1;
+        }
+
+        // iterative deepening from scratch: time-to-depth is the time of
+        // all the iterations up to the requested depth
+        double timeToDepth = 0;
+        Uint64 nodes = 0;
+        Uint64 previousNodes = 0;
+        table.clear();
+        SearchContext context(
+            config, NULL, &table, NULL, NULL, NULL, evaluator, network, &pool);
+        context.quiet = true;
+        for (Uint32 d = 1; d <= depth; ++d) {
+            config.depth = d;
+            Strategy s(p.blobs, *holes, p.player, context);
+            s.setSeed(i);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            s.computeBestMove();
+            auto end = std::chrono::high_resolution_clock::now();
+            timeToDepth +=
+                std::chrono::duration<double, std::milli>(end - start).count();
+
+            previousNodes = nodes;
+            nodes = s.nodes();
+            totalNodes += nodes;
+        }
+        double ebf = previousNodes ? (double)nodes / previousNodes : nodes;
+        totalTime += timeToDepth;
+        totalEbf += ebf;
+
+        ostringstream move;
+        if (context.hasBestMove) {
+            const movement& best = context.bestMove;
+            move << (Uint32)best.ox << "," << (Uint32)best.oy << "-"
+                 << (Uint32)best.nx << "," << (Uint32)best.ny;
+        } else {
+            move << "none";
+        }
+        cout << i << " " << p.map << " " << p.phase << " " << nodes << " "
+             << timeToDepth << " " << ebf << " " << move.str() << endl;
+
+        // FNV-1a over what the search found
+        string found = move.str() + " " + to_string(nodes) + ";";
+        for (char c : found) {
+            signature = (signature ^ (Uint8)c) * 1099511628211ULL;
+        }
+    }
+
+    cout << "positions: " << corpus.size() << endl;
+    cout << "depth: " << depth << endl;
+    cout << "total nodes: " << totalNodes << endl;
+    cout << "total time: " << totalTime << " ms" << endl;
+    cout << "nodes/sec: " << (Uint64)(totalNodes / (totalTime / 1000)) << endl;
+    cout << "average effective branching factor: "
+         << totalEbf / corpus.size() << endl;
+    cout << "search signature: " << hex << signature << dec << endl;
+
+    return 0;
+}
@@ -3,6 +3,7 @@
 #define GBLOBWAR
 // blobwar main class
 #include "common.h"
+#include "engine.h"
 #include "font.h"
 #include "mouse.h"
 #ifdef SOUND
@@ -102,6 +103,8 @@ class blobwar {
     font *smallfont;
     //! The time that IA have to do their computations
     int compute_time_IA;
+    //! settings given to launchStrategy (read from engine.cfg)
+    EngineConfig engine_config;
     /// constructor
     blobwar();
     /// destructor
@@ -0,0 +1,103 @@
+#include "book.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <fstream>
+
+void OpeningBook::close() {
+    if (_header != NULL) {
+        munmap((void*)_header, _length);
+    }
+    _header = NULL;
+    _entries = NULL;
+    _length = 0;
+}
+
+bool OpeningBook::open(const string& filename) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(BookHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid once the file is closed
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    _header = (const BookHeader*)data;
+    _entries = (const BookEntry*)(_header + 1);
+    _length = st.st_size;
+    if (_header->magic != BOOK_MAGIC || _header->version != BOOK_VERSION ||
+        _length != sizeof(BookHeader) + _header->count * sizeof(BookEntry)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool OpeningBook::openForHoles(Uint64 holes, const string& dirname) {
+    DIR* d = opendir(dirname.c_str());
+    if (d == NULL) {
+        return false;
+    }
+
+    bool found = false;
+    struct dirent* entry;
+    while (!found && (entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            found = open(dirname + entry->d_name) && _header->holes == holes;
+        }
+    }
+    closedir(d);
+
+    if (!found) {
+        close();
+    }
+    return found;
+}
+
+bool OpeningBook::probe(Uint64 key, BookEntry& result) const {
+    if (_header == NULL) {
+        return false;
+    }
+    const BookEntry* end = _entries + _header->count;
+    const BookEntry* e = lower_bound(
+        _entries, end, key, [](const BookEntry& a, Uint64 k) {
+            return a.key < k;
+        });
+    if (e == end || e->key != key) {
+        return false;
+    }
+    result = *e;
+    return true;
+}
+
+bool OpeningBook::write(const string& filename,
+                        Uint64 holes,
+                        vector<BookEntry> entries) {
+    sort(entries.begin(),
+         entries.end(),
+         [](const BookEntry& a, const BookEntry& b) { return a.key < b.key; });
+
+    ofstream outfile(filename.c_str(), ios::out | ios::binary);
+    if (!outfile) {
+        return false;
+    }
+    BookHeader header = {BOOK_MAGIC, BOOK_VERSION, (Uint32)entries.size(),
+                         holes};
+    outfile.write((const char*)&header, sizeof(header));
+    outfile.write((const char*)entries.data(),
+                  entries.size() * sizeof(BookEntry));
+    return (bool)outfile;
+}
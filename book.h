@@ -0,0 +1,105 @@
+#ifndef __BOOK_H
+#define __BOOK_H
+
+#include "SDL_stdinc.h"
+#include "bidiarray.h"
+#include "common.h"
+
+//! directory of the opening books, one per map (see buildBook)
+#define BOOKS_DIRECTORY "data/books/"
+
+//! first bytes of a book file ("blobbook" read as a little-endian word)
+#define BOOK_MAGIC 0x6b6f6f62626f6c62ULL
+//! version of the format, changes with the file layout or the hashes
+#define BOOK_VERSION 1
+
+//! mask of the holes of a map (cell x * 8 + y), which tells its book
+inline Uint64 holesMask(const bidiarray<bool>& holes) {
+    Uint64 mask = 0;
+    for (Uint8 x = 0; x < 8; ++x) {
+        for (Uint8 y = 0; y < 8; ++y) {
+            mask |= (Uint64)holes.get(x, y) << (x * 8 + y);
+        }
+    }
+    return mask;
+}
+
+//! a position of the book and the result of its search
+struct BookEntry {
+    //! hash of the position, player to move included (see Strategy::key)
+    Uint64 key;
+    //! score of the search for the player to move
+    Sint32 score;
+    //! cells of the best move, x * 8 + y
+    Uint8 from;
+    Uint8 to;
+    //! depth of the search
+    Uint8 depth;
+    Uint8 unused;
+};
+
+//! start of a book file, followed by the entries sorted by key
+struct BookHeader {
+    Uint64 magic;
+    Uint32 version;
+    //! number of entries
+    Uint32 count;
+    //! holes of the map of the book, which the hashes do not include
+    Uint64 holes;
+};
+
+/**
+ * Opening book: the best moves of the first plies of a map, searched
+ * offline far deeper than a game can afford.
+ * The file is mapped read-only, so opening a book reads nothing but its
+ * header and the processes playing on the same map share its pages. A
+ * lookup is a binary search on the sorted entries.
+ */
+class OpeningBook {
+   private:
+    //! the mapped file, NULL if no book is open
+    const BookHeader* _header;
+    const BookEntry* _entries;
+    //! length of the mapping
+    size_t _length;
+
+    void close();
+
+   public:
+    OpeningBook() : _header(NULL), _entries(NULL), _length(0) {}
+    ~OpeningBook() { close(); }
+
+    /**
+     * Map the book in filename, returns false (and has no book) if it
+     * cannot be read or is not a book of this version.
+     */
+    bool open(const string& filename);
+
+    /**
+     * Map the book of the map with these holes found in dirname, returns
+     * false if there is none.
+     */
+    bool openForHoles(Uint64 holes, const string& dirname = BOOKS_DIRECTORY);
+
+    //! false if no book is open
+    bool enabled() const { return _header != NULL; }
+
+    //! holes of the map of the book
+    Uint64 holes() const { return _header->holes; }
+
+    //! number of positions of the book
+    Uint32 size() const { return _header != NULL ? _header->count : 0; }
+
+    //! look for the position of hash key, returns false if it is not there
+    bool probe(Uint64 key, BookEntry& result) const;
+
+    /**
+     * Write the book of the map with these holes to filename (entries are
+     * sorted by key), returns false if the file cannot be written.
+     */
+    static bool write(const string& filename,
+                      Uint64 holes,
+                      vector<BookEntry> entries);
+};
+
+#endif
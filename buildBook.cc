@@ -0,0 +1,209 @@
+#include <chrono>
+#include <map>
+#include <set>
+
+#include "book.h"
+#include "mapfile.h"
+#include "strategy.h"
+
+//! plies of the game covered by default
+#define DEFAULT_BOOK_PLIES 4
+
+//! depth of the searches by default
+#define DEFAULT_BOOK_DEPTH 6
+
+/**
+ * Builds the book of one map.
+ * The book plays for either player, so the positions searched are those
+ * reached when one player (the book side) follows the book and the other
+ * plays any move, for each side in turn.
+ */
+class bookBuilder {
+   private:
+    const EngineConfig& config;
+    TranspositionTable& table;
+    const PatternEvaluator* evaluator;
+    const NetworkEvaluator* network;
+    const bidiarray<bool>& holes;
+    Uint32 plies;
+    //! the book so far, by key
+    map<Uint64, BookEntry> entries;
+    //! positions already walked for the current book side
+    set<Uint64> visited;
+
+    //! search the position, returns false if it has no move
+    bool search(const Strategy& position, BookEntry& result) {
+        bidiarray<Sint16> blobs;
+        position.getBlobs(blobs);
+        SearchContext context(
+            config, NULL, &table, NULL, NULL, NULL, evaluator, network);
+        context.quiet = true;
+        Strategy s(blobs, holes, position.currentPlayer(), context);
+        s.setSeed(0);
+        s.computeBestMove();
+        if (!context.hasBestMove) {
+            return false;
+        }
+        const movement& mv = context.bestMove;
+        result = {position.key(),
+                  context.bestScore,
+                  (Uint8)(mv.ox * 8 + mv.oy),
+                  (Uint8)(mv.nx * 8 + mv.ny),
+                  (Uint8)context.rootDepth,
+                  0};
+        return true;
+    }
+
+   public:
+    bookBuilder(const EngineConfig& config,
+                TranspositionTable& table,
+                const PatternEvaluator* evaluator,
+                const NetworkEvaluator* network,
+                const bidiarray<bool>& holes,
+                Uint32 plies)
+        : config(config),
+          table(table),
+          evaluator(evaluator),
+          network(network),
+          holes(holes),
+          plies(plies) {}
+
+    //! add the positions from position, ply plies into the game
+    void walk(Strategy& position, Uint16 bookSide, Uint32 ply) {
+        if (ply >= plies || !visited.insert(position.key()).second) {
+            return;
+        }
+        vector<movement> moves;
+        position.computeValidMoves(moves);
+        if (moves.empty()) {
+            return;
+        }
+
+        if (position.currentPlayer() == bookSide) {
+            auto known = entries.find(position.key());
+            if (known == entries.end()) {
+                BookEntry e;
+                if (!search(position, e)) {
+                    return;
+                }
+                known = entries.insert(make_pair(e.key, e)).first;
+            }
+            // only the move of the book is followed
+            moves.assign(1,
+                         movement(known->second.from >> 3,
+                                  known->second.from & 7,
+                                  known->second.to >> 3,
+                                  known->second.to & 7));
+        }
+        for (auto& mv : moves) {
+            Strategy next(position);
+            next.applyMove(mv);
+            next.switchPlayer();
+            walk(next, bookSide, ply + 1);
+        }
+    }
+
+    //! start a walk with another book side
+    void nextSide() { visited.clear(); }
+
+    vector<BookEntry> book() const {
+        vector<BookEntry> result;
+        for (auto& e : entries) {
+            result.push_back(e.second);
+        }
+        return result;
+    }
+};
+
+/** Main of buildBook
+ * Builds the opening book of each map: from the start of a two player
+ * game, every position of the first plies where a player follows the book
+ * is searched with the engine options (deep parallel alpha-beta by
+ * default), and the best moves are written to <directory>/<map>.book.
+ * launchStrategy plays them instead of searching (see OpeningBook).
+ */
+int main(int argc, char** argv) {
+    Uint32 plies = DEFAULT_BOOK_PLIES;
+    string directory = BOOKS_DIRECTORY;
+    vector<string> maps;
+
+    EngineConfig config;
+    config.algorithm = "alphabeta-parallel";
+    config.ttSize = 64;
+    config.depth = DEFAULT_BOOK_DEPTH;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-plies") == 0 && i + 1 < argc) {
+            plies = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-out") == 0 && i + 1 < argc) {
+            directory = argv[++i];
+            if (directory.back() != '/') {
+                directory += '/';
+            }
+        } else if (argv[i][0] != '-') {
+            maps.push_back(argv[i]);
+        } else if (i + 1 >= argc ||
+                   !setEngineOption(config, argv[i] + 1, argv[i + 1])) {
+            printf("usage: ./buildBook [-plies n] [-out dir] [options] "
+                   "[map ...]\n");
+            printf("	-plies <n> plies covered by the books (default: %d).\n",
+                   DEFAULT_BOOK_PLIES);
+            printf("	-out <dir> directory of the books (default: %s).\n",
+                   BOOKS_DIRECTORY);
+            printf("	map names of data/boards (default: all of them).\n");
+            printf(
+                "	engine options (default: -algo alphabeta-parallel -tt 64 "
+                "-depth %d):\n",
+                DEFAULT_BOOK_DEPTH);
+            displayEngineUsage();
+            return 1;
+        } else {
+            ++i;
+        }
+    }
+    if (maps.empty()) {
+        maps = listMaps();
+    }
+    // the books are built from fixed depth searches
+    config.time = 0;
+    config.book = false;
+    TranspositionTable table(config.ttSize);
+    PatternEvaluator patterns;
+    const PatternEvaluator* evaluator = loadEvaluator(config, patterns);
+    NetworkEvaluator weights;
+    const NetworkEvaluator* network = loadNetwork(config, weights);
+
+    for (auto& name : maps) {
+        bidiarray<bool> holes;
+        if (!loadMap(MAPS_DIRECTORY + name, holes)) {
+            cerr << "unable to load map " << name << endl;
+            return 1;
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+
+        bidiarray<Sint16> blobs;
+        initialBlobs(blobs);
+        SearchContext context(config);
+        Strategy position(blobs, holes, 0, context);
+        position.initializeScores();
+
+        table.clear();
+        bookBuilder builder(config, table, evaluator, network, holes, plies);
+        for (Uint16 side = 0; side < 2; ++side) {
+            builder.nextSide();
+            builder.walk(position, side, 0);
+        }
+
+        vector<BookEntry> book = builder.book();
+        string filename = directory + name + ".book";
+        if (!OpeningBook::write(filename, holesMask(holes), book)) {
+            cerr << "unable to write " << filename << endl;
+            return 1;
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        cout << name << ": " << book.size() << " positions in "
+             << elapsed.count() << " s" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,388 @@
+#include "endgame.h"
+
+//! largest number of moves of a position: a copy and at most 16 jumps
+//! into each empty cell (a region filled alone may leave more than
+//! ENDGAME_MAX_EMPTIES of them)
+#define ENDGAME_MAX_MOVES (64 * 17)
+
+//! key of the best move of the table, searched first
+#define KEY_TABLE_MOVE 255
+
+//! cell of a spare move (see EndgameSolver)
+#define SPARE_MOVE 64
+
+//! regions are not looked for with this number of empty cells or less
+#define ENDGAME_SPLIT_MIN 6
+
+//! the move from cell from to cell to, as the rest of the game sees it
+static movement toMovement(Uint8 from, Uint8 to) {
+    return movement(from >> 3, from & 7, to >> 3, to & 7);
+}
+
+//! cells within four cells of mask: moves into cells further apart neither
+//! start from nor capture the same blobs
+static Uint64 influence(Uint64 mask) { return reach(reach(mask)); }
+
+//! cells of region the owner of blobs can fill with copies
+static Uint64 fillable(Uint64 blobs, Uint64 region) {
+    Uint64 filled = 0;
+    for (Uint64 next = grow(blobs) & region; next != filled;
+         next = grow(blobs | next) & region) {
+        filled = next;
+    }
+    return filled;
+}
+
+EndgameSolver::EndgameSolver(Uint64 holes,
+                             SearchStats& stats,
+                             const std::function<bool()>& stop)
+    : _holes(holes), _stats(stats), _stop(stop) {
+    _table = new entry[1 << ENDGAME_TABLE_BITS]();
+}
+
+EndgameSolver::~EndgameSolver() { delete[] _table; }
+
+EndgameSolver::regions EndgameSolver::splitRegions(Uint64 holes,
+                                                   Uint64 mine,
+                                                   Uint64 theirs) {
+    regions r = {{0, 0}, 0, 0};
+    Uint64 empty = ~(mine | theirs | holes);
+    while (empty) {
+        Uint64 region = empty & -empty;
+        for (Uint64 next = influence(region) & empty; next != region;
+             next = influence(region) & empty) {
+            region = next;
+        }
+        empty &= ~region;
+
+        Uint64 around = reach(region);
+        if (!(around & (mine | theirs))) {
+            // no one will ever play there
+            continue;
+        }
+        Uint64 open = region;
+        if (!(around & theirs)) {
+            Uint64 filled = fillable(mine, region);
+            r.filled[0] |= filled;
+            open &= ~filled;
+        } else if (!(around & mine)) {
+            Uint64 filled = fillable(theirs, region);
+            r.filled[1] |= filled;
+            open &= ~filled;
+        }
+        r.open |= open;
+        if (cellCount(open) & 1) {
+            r.odd |= open;
+        }
+    }
+    return r;
+}
+
+EndgameSolver::entry& EndgameSolver::lookup(Uint64 mine,
+                                            Uint64 theirs,
+                                            Uint8 jumps,
+                                            Uint8 spareMine,
+                                            Uint8 spareTheirs) const {
+    Uint64 h = (mine * 0x9E3779B97F4A7C15ULL) ^
+               (theirs * 0xC2B2AE3D27D4EB4FULL) ^ jumps ^ (spareMine << 8) ^
+               (spareTheirs << 16);
+    h ^= h >> 29;
+    return _table[(h * 0xBF58476D1CE4E5B9ULL) >> (64 - ENDGAME_TABLE_BITS)];
+}
+
+Uint32 EndgameSolver::generate(Uint64 mine,
+                               Uint64 theirs,
+                               Uint64 odd,
+                               Uint8 jumps,
+                               const entry* known,
+                               endgameMove* moves) {
+    Uint64 empty = ~(mine | theirs | _holes);
+
+    // copies from different blobs to the same cell give the same position,
+    // only one of them is kept
+    Uint32 n = 0;
+    for (Uint64 targets = reach(mine) & empty; targets;
+         targets &= targets - 1) {
+        Uint8 to = firstCell(targets);
+        Uint64 near = grow(1ULL << to);
+        Uint8 parity = (odd >> to) & 1;
+        Uint8 key = (cellCount(near & theirs) << 2) | parity;
+
+        if (near & mine) {
+            moves[n++] = {
+                firstCell(near & mine), to, false, (Uint8)(key | 2)};
+        }
+        Uint64 origins = reach(1ULL << to) & ~near & mine;
+        if (jumps == 0) {
+            if (origins != 0) {
+                _restricted = true;
+                _cut = true;
+            }
+            continue;
+        }
+        for (; origins; origins &= origins - 1) {
+            moves[n++] = {firstCell(origins), to, true, key};
+        }
+    }
+
+    if (known != NULL) {
+        for (Uint32 i = 0; i < n; ++i) {
+            if (moves[i].from == known->from && moves[i].to == known->to &&
+                moves[i].jump == known->jump) {
+                moves[i].key = KEY_TABLE_MOVE;
+                break;
+            }
+        }
+    }
+    return n;
+}
+
+void EndgameSolver::play(const endgameMove& mv, Uint64& mine, Uint64& theirs) {
+    if (mv.jump) {
+        mine &= ~(1ULL << mv.from);
+    }
+    Uint64 captured = theirs & grow(1ULL << mv.to);
+    mine |= captured | (1ULL << mv.to);
+    theirs &= ~captured;
+}
+
+Sint32 EndgameSolver::search(Uint64 mine,
+                             Uint64 theirs,
+                             Sint32 alpha,
+                             Sint32 beta,
+                             Uint8 jumps,
+                             Uint8 spareMine,
+                             Uint8 spareTheirs) {
+    ++_stats.nodes;
+    // the scores of a stopped search are never used
+    if (_stopped || ((_stats.nodes & (ENDGAME_CHECK_NODES - 1)) == 0 &&
+                     _stop && (_stopped = _stop()))) {
+        return 0;
+    }
+
+    _cut = false;
+
+    // the game stops when a player has no blobs left: the cells of the
+    // spare moves not played yet were never filled
+    if (mine == 0 || theirs == 0) {
+#ifdef _STAT
+        ++_stats.leaves;
+#endif
+        return (Sint32)cellCount(mine) - (Sint32)cellCount(theirs) -
+               spareMine + spareTheirs;
+    }
+
+    // a region reached by one player only is filled now, its cells become
+    // spare moves of this player (the last cells are not worth it)
+    Uint64 empty = ~(mine | theirs | _holes);
+    regions r = {{0, 0}, empty, 0};
+    if (cellCount(empty) > ENDGAME_SPLIT_MIN) {
+        r = splitRegions(_holes, mine, theirs);
+        mine |= r.filled[0];
+        theirs |= r.filled[1];
+        spareMine += cellCount(r.filled[0]);
+        spareTheirs += cellCount(r.filled[1]);
+        empty &= ~(r.filled[0] | r.filled[1]);
+    }
+
+    Sint32 difference = (Sint32)cellCount(mine) - (Sint32)cellCount(theirs);
+    bool canMove = reach(mine) & empty;
+
+    // end of the game, or a pass
+    if (!canMove && spareMine == 0) {
+        if ((reach(theirs) & empty) || spareTheirs != 0) {
+            return -search(
+                theirs, mine, -beta, -alpha, jumps, spareTheirs, spareMine);
+        }
+#ifdef _STAT
+        ++_stats.leaves;
+#endif
+        return difference;
+    }
+
+    entry& e = lookup(mine, theirs, jumps, spareMine, spareTheirs);
+    bool found = e.mine == mine && e.theirs == theirs && e.jumps == jumps &&
+                 e.spareMine == spareMine && e.spareTheirs == spareTheirs;
+#ifdef _STAT
+    ++_stats.ttProbes;
+    _stats.ttHits += found;
+#endif
+    if (found) {
+        _cut = e.cut;
+        if (e.lower == e.upper || e.lower >= beta) {
+            return e.lower;
+        }
+        if (e.upper <= alpha) {
+            return e.upper;
+        }
+        alpha = max<Sint32>(alpha, e.lower);
+        beta = min<Sint32>(beta, e.upper);
+    }
+
+    endgameMove moves[ENDGAME_MAX_MOVES];
+    Uint32 n = canMove ? generate(mine, theirs, r.odd, jumps,
+                                  found ? &e : NULL, moves)
+                       : 0;
+    bool cut = _cut;
+#ifdef _STAT
+    _stats.moves += n;
+    _stats.players += cellCount(mine);
+#endif
+    if (n == 0 && spareMine == 0) {
+        // only jumps are left and the line has none: the difference is
+        // only what the line reached (cut is set)
+#ifdef _STAT
+        ++_stats.leaves;
+#endif
+        return difference;
+    }
+
+    // the spare move, if any, is searched after the others
+    Sint32 alphaOrig = alpha;
+    Sint32 best = -ENDGAME_INFINITY;
+    endgameMove bestMove = {SPARE_MOVE, SPARE_MOVE, false, 0};
+    Uint32 count = n + (spareMine != 0);
+    for (Uint32 i = 0; i < count; ++i) {
+        Sint32 score;
+        if (i == n) {
+            score = -search(theirs,
+                            mine,
+                            -beta,
+                            -alpha,
+                            jumps,
+                            spareTheirs,
+                            spareMine - 1);
+        } else {
+            // the best remaining move, most nodes only search the first
+            // ones
+            for (Uint32 j = i + 1; j < n; ++j) {
+                if (moves[j].key > moves[i].key) {
+                    swap(moves[i], moves[j]);
+                }
+            }
+
+            Uint64 nextMine = mine;
+            Uint64 nextTheirs = theirs;
+            play(moves[i], nextMine, nextTheirs);
+            score = -search(nextTheirs,
+                            nextMine,
+                            -beta,
+                            -alpha,
+                            jumps - moves[i].jump,
+                            spareTheirs,
+                            spareMine);
+        }
+        cut |= _cut;
+
+        if (score > best) {
+            best = score;
+            bestMove = i == n ? endgameMove{SPARE_MOVE, SPARE_MOVE, false, 0}
+                              : moves[i];
+            if (score > alpha) {
+                alpha = score;
+            }
+            if (score >= beta) {
+#ifdef _STAT
+                ++_stats.betaCutoffs;
+                _stats.firstMoveCutoffs += i == 0;
+#endif
+                break;
+            }
+        }
+    }
+
+    // a value cut by the jump budget is not the value of the position,
+    // only a bound of it under the budget: it never gives both bounds
+    Sint8 lower = best > alphaOrig ? best : -ENDGAME_INFINITY;
+    Sint8 upper = best < beta ? best : ENDGAME_INFINITY;
+    if (cut && lower == upper) {
+        upper = ENDGAME_INFINITY;
+    }
+    // the searches below may have used the entry
+    _cut = cut;
+    e = {mine,
+         theirs,
+         lower,
+         upper,
+         jumps,
+         spareMine,
+         spareTheirs,
+         bestMove.from,
+         bestMove.to,
+         bestMove.jump,
+         cut};
+    return best;
+}
+
+Sint32 EndgameSolver::solve(
+    Uint64 mine,
+    Uint64 theirs,
+    const std::function<void(const movement&, Sint32)>& improved) {
+    _restricted = false;
+    _stopped = false;
+
+    endgameMove moves[ENDGAME_MAX_MOVES];
+    Uint32 n = generate(mine,
+                        theirs,
+                        splitRegions(_holes, mine, theirs).odd,
+                        ENDGAME_JUMPS,
+                        NULL,
+                        moves);
+    if (n == 0) {
+        return search(mine,
+                      theirs,
+                      -ENDGAME_INFINITY,
+                      ENDGAME_INFINITY,
+                      ENDGAME_JUMPS,
+                      0,
+                      0);
+    }
+    stable_sort(moves,
+                moves + n,
+                [](const endgameMove& a, const endgameMove& b) {
+                    return a.key > b.key;
+                });
+    Uint64 first = mine;
+    Uint64 firstTheirs = theirs;
+    play(moves[0], first, firstTheirs);
+    // a move to play if the search does not finish
+    improved(toMovement(moves[0].from, moves[0].to),
+             (Sint32)cellCount(first) - (Sint32)cellCount(firstTheirs));
+
+    Sint32 alpha = -ENDGAME_INFINITY;
+    for (Uint8 jumps = 0; jumps <= ENDGAME_JUMPS; ++jumps) {
+        ++_stats.nodes;
+        _restricted = false;
+        alpha = -ENDGAME_INFINITY;
+        Uint32 best = 0;
+        for (Uint32 i = 0; i < n; ++i) {
+            if (moves[i].jump && jumps == 0) {
+                _restricted = true;
+                continue;
+            }
+            Uint64 nextMine = mine;
+            Uint64 nextTheirs = theirs;
+            play(moves[i], nextMine, nextTheirs);
+            Sint32 score = -search(nextTheirs,
+                                   nextMine,
+                                   -ENDGAME_INFINITY,
+                                   -alpha,
+                                   jumps - moves[i].jump,
+                                   0,
+                                   0);
+            if (_stopped) {
+                return alpha;
+            }
+            if (score > alpha) {
+                alpha = score;
+                best = i;
+                improved(toMovement(moves[i].from, moves[i].to), score);
+            }
+        }
+        if (!_restricted) {
+            break;
+        }
+        rotate(moves, moves + best, moves + best + 1);
+    }
+    return alpha;
+}
@@ -0,0 +1,172 @@
+#ifndef __ENDGAME_H
+#define __ENDGAME_H
+
+#include <functional>
+
+#include "SDL_stdinc.h"
+#include "move.h"
+#include "rulescore.h"
+#include "searchstats.h"
+
+//! the solver is not used with more open cells than this (see openCells)
+#define ENDGAME_MAX_EMPTIES 20
+
+//! jumps do not fill the board, so a line could go on forever: each line
+//! of the solver plays at most this number of jumps (the root is solved
+//! again with one more jump allowed, from none to this one)
+#define ENDGAME_JUMPS 2
+
+//! number of entries of the table of the solver (a power of two)
+#define ENDGAME_TABLE_BITS 16
+
+//! bound of the scores of the solver (a blob difference)
+#define ENDGAME_INFINITY 100
+
+//! nodes between two calls of the stop function of the solver (a power of
+//! two)
+#define ENDGAME_CHECK_NODES 1024
+
+/**
+ * Exact solver of the end of a two player game.
+ * Searches every line to the end of the game and scores the final position
+ * by its blob difference, the score estimateCurrentScore gives at the end
+ * of a game, with passes when only the opponent can move.
+ * Positions are seen from the player to move (its blobs, the other
+ * player's blobs), which is all their value depends on, and the solver
+ * keeps its own small table of bounds.
+ *
+ * The empty cells are split in regions (see splitRegions). A region only
+ * one player reaches is filled at once by this player, who gets one spare
+ * move per filled cell to play whenever it wants: the rest of the board is
+ * searched without the cross product of the moves of both parts.
+ * Moves are ordered by captures, copies before jumps, then parity: a move
+ * into a region with an odd number of open cells comes first, to be the
+ * one who fills it last. Spare moves come last.
+ */
+class EndgameSolver {
+   public:
+    //! the empty cells of a position, split in regions
+    struct regions {
+        //! cells the player owning mine (0) or theirs (1) fills alone
+        Uint64 filled[2];
+        //! cells left to play for: the regions both players reach and the
+        //! cells a lone player can only jump to
+        Uint64 open;
+        //! open cells of the regions with an odd number of open cells
+        Uint64 odd;
+    };
+
+   private:
+    //! a move of the solver, cells are x * 8 + y
+    struct endgameMove {
+        Uint8 from;
+        Uint8 to;
+        bool jump;
+        //! ordering key, the highest first
+        Uint8 key;
+    };
+
+    //! bounds of the value of a position, with the jumps and spare moves
+    //! left
+    struct entry {
+        Uint64 mine;
+        Uint64 theirs;
+        Sint8 lower;
+        Sint8 upper;
+        Uint8 jumps;
+        Uint8 spareMine;
+        Uint8 spareTheirs;
+        Uint8 from;
+        Uint8 to;
+        bool jump;
+        //! the bounds depend on a line that ran out of jumps
+        bool cut;
+    };
+
+    Uint64 _holes;
+    SearchStats& _stats;
+    entry* _table;
+    //! a line ran out of jumps while some were possible
+    bool _restricted = false;
+    //! the value search returned last depends on a line that ran out of
+    //! jumps: it is only known under the jump budget, and kept in the
+    //! table as a bound
+    bool _cut = false;
+    //! tells when to stop (may be empty), and whether it did: every node
+    //! then returns at once
+    std::function<bool()> _stop;
+    bool _stopped = false;
+
+    entry& lookup(Uint64 mine,
+                  Uint64 theirs,
+                  Uint8 jumps,
+                  Uint8 spareMine,
+                  Uint8 spareTheirs) const;
+
+    //! moves of the player owning mine, ordered (the best move of the
+    //! table first), returns their number
+    Uint32 generate(Uint64 mine,
+                    Uint64 theirs,
+                    Uint64 odd,
+                    Uint8 jumps,
+                    const entry* known,
+                    endgameMove* moves);
+
+    //! play mv for the player owning mine
+    static void play(const endgameMove& mv, Uint64& mine, Uint64& theirs);
+
+    //! value of the position for the player owning mine, fail soft
+    Sint32 search(Uint64 mine,
+                  Uint64 theirs,
+                  Sint32 alpha,
+                  Sint32 beta,
+                  Uint8 jumps,
+                  Uint8 spareMine,
+                  Uint8 spareTheirs);
+
+   public:
+    //! counts its nodes in stats, stops as soon as stop returns true (the
+    //! table then holds wrong bounds: a stopped solver is not solved again)
+    EndgameSolver(Uint64 holes,
+                  SearchStats& stats,
+                  const std::function<bool()>& stop = nullptr);
+    ~EndgameSolver();
+
+    /**
+     * Split the empty cells in regions: empty cells closer than five cells
+     * are in the same region, so that moves into two regions never start
+     * from, nor capture, the same blobs. A region only one player reaches
+     * stays its own (the other player could only come closer by jumping
+     * next to it, which the solver does not follow) and dead if no one
+     * reaches it.
+     */
+    static regions splitRegions(Uint64 holes, Uint64 mine, Uint64 theirs);
+
+    //! number of cells left to play for (see regions::open)
+    static Uint32 openCells(Uint64 holes, Uint64 mine, Uint64 theirs) {
+        return cellCount(splitRegions(holes, mine, theirs).open);
+    }
+
+    /**
+     * Final blob difference of the player owning mine under perfect play.
+     * improved is called with the first move, then with every better
+     * move found, so that a search interrupted early still has a move:
+     * lines without jumps are solved first, then the best move is searched
+     * first again with one more jump per line. A stopped solve keeps
+     * the best move of the root moves solved to the end.
+     */
+    Sint32 solve(Uint64 mine,
+                 Uint64 theirs,
+                 const std::function<void(const movement&, Sint32)>& improved);
+
+    /**
+     * False if a line of the last solve ran out of jumps: its score is
+     * then exact among the lines of at most ENDGAME_JUMPS jumps only.
+     */
+    bool exact() const { return !_restricted; }
+
+    //! the last solve was stopped before its end
+    bool stopped() const { return _stopped; }
+};
+
+#endif
@@ -0,0 +1,268 @@
+#include "engine.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+
+#include "endgame.h"
+#include "strategy.h"
+
+const EngineConfig defaultEngineConfig;
+
+const Engine engines[] = {
+    {"greedy", "best immediate capture", &Strategy::searchGreedy, 0, false},
+    {"minmax", "minmax", &Strategy::searchMinMax, 4000000, false},
+    {"alphabeta",
+     "minmax with alpha-beta pruning",
+     &Strategy::searchAlphaBeta,
+     8000000000,
+     false},
+    {"aspiration",
+     "alpha-beta with a window around the score of the previous iteration",
+     &Strategy::searchAspiration,
+     8000000000,
+     false},
+    {"mtdf",
+     "MTD(f): null window alpha-beta searches closing in on the score "
+     "(best with -tt)",
+     &Strategy::searchMtdf,
+     8000000000,
+     false},
+    {"alphabeta-parallel",
+     "alpha-beta with root moves searched in parallel",
+     &Strategy::searchAlphaBetaParallel,
+     8000000000,
+     false},
+    {"mcts",
+     "Monte Carlo tree search (UCT with progressive bias), -time ms or "
+     "20000 playouts",
+     &Strategy::searchMcts,
+     0,
+     true},
+    {NULL, NULL, NULL, 0, false}};
+
+const Engine* findEngine(const string& name) {
+    for (const Engine* e = engines; e->name != NULL; ++e) {
+        if (name == e->name) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+//! parse a positive integer, returns false if value is not one or does
+//! not fit in 32 bits
+static bool parseNumber(const string& value, Uint32& number) {
+    // (strtoul also takes spaces and signs)
+    if (value.empty() ||
+        value.find_first_not_of("0123456789") != string::npos) {
+        return false;
+    }
+    char* end;
+    errno = 0;
+    unsigned long parsed = strtoul(value.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || parsed > UINT32_MAX) {
+        return false;
+    }
+    number = parsed;
+    return true;
+}
+
+//! parse 0 or 1, returns false if value is neither
+static bool parseFlag(const string& value, bool& flag) {
+    if (value != "0" && value != "1") {
+        return false;
+    }
+    flag = value == "1";
+    return true;
+}
+
+bool setEngineOption(EngineConfig& config,
+                     const string& name,
+                     const string& value) {
+    bool valid = true;
+    if (name == "algo") {
+        valid = findEngine(value) != NULL;
+        config.algorithm = value;
+    } else if (name == "threads") {
+        valid = parseNumber(value, config.threads);
+    } else if (name == "affinity") {
+        valid = parseFlag(value, config.affinity);
+    } else if (name == "tt") {
+        valid = parseNumber(value, config.ttSize);
+    } else if (name == "ttfile") {
+        config.ttFile = value;
+    } else if (name == "depth") {
+        valid = parseNumber(value, config.depth);
+    } else if (name == "time") {
+        valid = parseNumber(value, config.time);
+    } else if (name == "endgame") {
+        valid = parseNumber(value, config.endgame) &&
+                config.endgame <= ENDGAME_MAX_EMPTIES;
+    } else if (name == "nullmove") {
+        valid = parseFlag(value, config.nullMove);
+    } else if (name == "lmr") {
+        valid = parseFlag(value, config.lmr);
+    } else if (name == "futility") {
+        valid = parseFlag(value, config.futility);
+    } else if (name == "book") {
+        valid = parseFlag(value, config.book);
+    } else if (name == "reuse") {
+        valid = parseFlag(value, config.reuse);
+    } else if (name == "eval") {
+        valid =
+            value == "material" || value == "patterns" || value == "network";
+        config.evaluation = value;
+    } else if (name == "weights") {
+        config.weights = value;
+    } else if (name == "net") {
+        config.network = value;
+    } else {
+        cerr << "unknown engine option: " << name << endl;
+        return false;
+    }
+    if (!valid) {
+        cerr << "invalid value for engine option " << name << ": " << value
+             << endl;
+    }
+    return valid;
+}
+
+bool parseEngineOptions(EngineConfig& config,
+                        int argc,
+                        char** argv,
+                        int first) {
+    for (int i = first; i < argc; i += 2) {
+        if (argv[i][0] != '-' || i + 1 >= argc) {
+            cerr << "expected -option value, got " << argv[i] << endl;
+            return false;
+        }
+        if (!setEngineOption(config, argv[i] + 1, argv[i + 1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool loadEngineConfig(EngineConfig& config, const string& filename) {
+    ifstream infile(filename.c_str(), ios::in);
+    if (!infile) {
+        return false;
+    }
+
+    string line;
+    while (getline(infile, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t equal = line.find('=');
+        if (equal == string::npos ||
+            !setEngineOption(
+                config, line.substr(0, equal), line.substr(equal + 1))) {
+            cerr << "ignoring line of " << filename << ": " << line << endl;
+        }
+    }
+    return true;
+}
+
+const PatternEvaluator* loadEvaluator(const EngineConfig& config,
+                                      PatternEvaluator& evaluator) {
+    if (config.evaluation != "patterns") {
+        return NULL;
+    }
+    if (!evaluator.load(config.weights)) {
+        cerr << "unable to load the weights of " << config.weights
+             << ", evaluating material" << endl;
+        return NULL;
+    }
+    return &evaluator;
+}
+
+const NetworkEvaluator* loadNetwork(const EngineConfig& config,
+                                    NetworkEvaluator& network) {
+    if (config.evaluation != "network") {
+        return NULL;
+    }
+    if (!network.load(config.network)) {
+        cerr << "unable to load the network of " << config.network
+             << ", evaluating material" << endl;
+        return NULL;
+    }
+    return &network;
+}
+
+vector<string> engineArguments(const EngineConfig& config) {
+    vector<string> args;
+    args.push_back("-algo");
+    args.push_back(config.algorithm);
+    args.push_back("-threads");
+    args.push_back(to_string(config.threads));
+    args.push_back("-affinity");
+    args.push_back(to_string(config.affinity));
+    args.push_back("-tt");
+    args.push_back(to_string(config.ttSize));
+    if (!config.ttFile.empty()) {
+        args.push_back("-ttfile");
+        args.push_back(config.ttFile);
+    }
+    args.push_back("-depth");
+    args.push_back(to_string(config.depth));
+    args.push_back("-time");
+    args.push_back(to_string(config.time));
+    args.push_back("-endgame");
+    args.push_back(to_string(config.endgame));
+    args.push_back("-nullmove");
+    args.push_back(to_string(config.nullMove));
+    args.push_back("-lmr");
+    args.push_back(to_string(config.lmr));
+    args.push_back("-futility");
+    args.push_back(to_string(config.futility));
+    args.push_back("-book");
+    args.push_back(to_string(config.book));
+    args.push_back("-reuse");
+    args.push_back(to_string(config.reuse));
+    args.push_back("-eval");
+    args.push_back(config.evaluation);
+    args.push_back("-weights");
+    args.push_back(config.weights);
+    args.push_back("-net");
+    args.push_back(config.network);
+    return args;
+}
+
+void displayEngineUsage() {
+    printf("	-algo <name> search algorithm (default: minmax):\n");
+    for (const Engine* e = engines; e->name != NULL; ++e) {
+        printf("		%s: %s\n", e->name, e->description);
+    }
+    printf("	-threads <n> threads searching root moves (0: one per core)\n");
+    printf(
+        "	-affinity <0|1> bind each thread searching root moves to a "
+        "core (default: 0)\n");
+    printf("	-tt <MB> transposition table size (0: none)\n");
+    printf(
+        "	-ttfile <file> keep the transposition table in file, shared "
+        "by the searches of all processes (default: in memory)\n");
+    printf("	-depth <d> search depth (0: estimated)\n");
+    printf(
+        "	-time <ms> stop iterative deepening after this time (0: a single "
+        "search)\n");
+    printf(
+        "	-endgame <n> solve exactly from n empty cells left to play for "
+        "(default: 12, at most %d, 0: never)\n",
+        ENDGAME_MAX_EMPTIES);
+    printf("	-nullmove <0|1> null move pruning (default: 0)\n");
+    printf("	-lmr <0|1> late move reductions (default: 0)\n");
+    printf("	-futility <0|1> futility pruning (default: 0)\n");
+    printf("	-book <0|1> play the opening book of the map (default: 1)\n");
+    printf(
+        "	-reuse <0|1> mcts keeps its tree from one move to the next, when "
+        "the program plays whole games (default: 0)\n");
+    printf(
+        "	-eval <material|patterns|network> evaluation of the leaves "
+        "(default: material)\n");
+    printf("	-weights <file> weights of the patterns (default: %s)\n",
+           PATTERN_WEIGHTS_FILE);
+    printf("	-net <file> weights of the network (default: %s)\n",
+           NETWORK_FILE);
+}
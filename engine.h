@@ -0,0 +1,122 @@
+#ifndef __ENGINE_H
+#define __ENGINE_H
+
+#include "SDL_stdinc.h"
+#include "common.h"
+#include "nnue.h"
+#include "patterns.h"
+
+class Strategy;
+
+//! file read by blobwar to configure the AI
+#define ENGINE_CONFIG_FILE "engine.cfg"
+
+/**
+ * Settings of the AI, chosen at runtime.
+ * launchStrategy reads them from its options (-algo alphabeta -tt 64 ...),
+ * blobwar from engine.cfg (algo=alphabeta, tt=64, ...) and passes them on.
+ */
+struct EngineConfig {
+    //! name of the algorithm, see engines
+    string algorithm = "minmax";
+    //! number of threads searching root moves, 0 for one per core
+    Uint32 threads = 0;
+    //! bind each thread searching root moves to its own core
+    bool affinity = false;
+    //! size of the transposition table in MB, 0 disables it
+    Uint32 ttSize = 0;
+    //! file holding the transposition table, kept from one search to the
+    //! next and shared by the processes using it (empty: in memory)
+    string ttFile;
+    //! depth of the search, 0 to estimate it from the number of moves
+    Uint32 depth = 0;
+    //! time budget in ms: iterative deepening stops at its end, in the
+    //! middle of an iteration if need be (0: a single search at depth)
+    Uint32 time = 0;
+    //! number of empty cells left to play for (see EndgameSolver) from
+    //! which the endgame solver plays instead of the algorithm (0 disables
+    //! it)
+    Uint32 endgame = 12;
+    //! selective search of alphabeta and the algorithms built on it: null
+    //! move pruning, late move reductions and futility pruning (each on or
+    //! off, see computeMinMaxAlphaBetaMove)
+    bool nullMove = false;
+    bool lmr = false;
+    bool futility = false;
+    //! play the move of the opening book of the map when it has the
+    //! position (see OpeningBook)
+    bool book = true;
+    //! MCTS keeps its tree from one move to the next, in the programs
+    //! playing whole games (tournament, see MonteCarloTree::reroot)
+    bool reuse = false;
+    //! evaluation of the leaves: material (blob difference), patterns
+    //! (PatternEvaluator) or network (NetworkEvaluator)
+    string evaluation = "material";
+    //! file of the weights of the patterns
+    string weights = PATTERN_WEIGHTS_FILE;
+    //! file of the weights of the network
+    string network = NETWORK_FILE;
+};
+
+//! settings used when none are given
+extern const EngineConfig defaultEngineConfig;
+
+/**
+ * A search algorithm of the registry
+ */
+struct Engine {
+    //! name used by -algo and engine.cfg
+    const char* name;
+    const char* description;
+    //! search the root of the strategy to depth, returns its score
+    Sint32 (Strategy::*search)(Uint32 depth);
+    //! number of boards the depth estimation may visit
+    Sint64 maxBoards;
+    //! the search has no depth and stops on its own once the time budget
+    //! is spent (no iterative deepening), the endgame solver plays for it
+    bool anytime;
+};
+
+//! all available algorithms, the list ends with a NULL name
+extern const Engine engines[];
+
+//! the algorithm called name, NULL if there is none
+const Engine* findEngine(const string& name);
+
+/**
+ * Set one option of config from its name (without the dash) and value.
+ * Returns false and prints why on an unknown option or a bad value.
+ */
+bool setEngineOption(EngineConfig& config,
+                     const string& name,
+                     const string& value);
+
+//! parse the "-name value" pairs of argv[first..argc[
+bool parseEngineOptions(EngineConfig& config,
+                        int argc,
+                        char** argv,
+                        int first);
+
+//! read "name=value" lines of filename, returns false if it is unreadable
+bool loadEngineConfig(EngineConfig& config, const string& filename);
+
+/**
+ * The evaluator of config: evaluator with the weights of config loaded if
+ * it evaluates with patterns, NULL for material (and, saying why, when the
+ * weights cannot be read).
+ */
+const PatternEvaluator* loadEvaluator(const EngineConfig& config,
+                                      PatternEvaluator& evaluator);
+
+//! the network of config: network loaded if it evaluates with the network,
+//! NULL otherwise (as loadEvaluator)
+const NetworkEvaluator* loadNetwork(const EngineConfig& config,
+                                    NetworkEvaluator& network);
+
+//! options giving config to launchStrategy
+vector<string> engineArguments(const EngineConfig& config);
+
+//! print the options and the algorithms
+void displayEngineUsage();
+
+#endif
@@ -4,6 +4,7 @@
 
 #include <chrono>
 
+#include "searchpool.h"
 #include "shmem.h"
 #include "strategy.h"
 
@@ -27,13 +28,16 @@ void saveBestMoveToShmem(movement& m) {
  * - blobs (serialized)
  * - holes (serialized)
  * - current player (an int)
+ * followed by options:
+ * - the engine options (-algo, -threads, -tt, -depth, -time, ...)
+ * - -trace <file> to write a Chrome trace of the search in file
  */
 int main(int argc, char** argv) {
 #ifdef DEBUG
     cout << "Starting launchStrategy" << endl;
 #endif
-    if (argc != 4) {
-        printf("Usage: ./launchStrategy blobs holes current_player\n");
+    if (argc < 4 || (argc - 4) % 2 != 0) {
+        printf("Usage: ./launchStrategy blobs holes current_player [options]\n");
         printf(
             "	blobs is a serialized bidiarray<Sint16> containing the "
             "blobs\n");
@@ -42,6 +46,8 @@ int main(int argc, char** argv) {
         printf(
             "	current_player is an int indicating which player should "
             "play\n");
+        displayEngineUsage();
+        printf("	-trace <file> write a Chrome trace of the search\n");
         return 1;
     }
     int i = 1;
@@ -52,14 +58,43 @@ int main(int argc, char** argv) {
     // holes.display();
     int cplayer = atoi(argv[i++]);
     // std::cout << "player: "<<cplayer<<std::endl;
-    void (*func)(movement&) = saveBestMoveToShmem;
+
+    EngineConfig config;
+    SearchTrace trace;
+    bool tracing = false;
+    for (; i < argc; i += 2) {
+        if (strcmp(argv[i], "-trace") == 0) {
+            tracing = trace.open(argv[i + 1]);
+        } else if (argv[i][0] != '-' ||
+                   !setEngineOption(config, argv[i] + 1, argv[i + 1])) {
+            return 1;
+        }
+    }
 
     shmem_init();
-    func = saveBestMoveToShmem;
 
     auto start = std::chrono::high_resolution_clock::now();
-    Strategy strategy(blobs, holes, cplayer, func);
+    TranspositionTable table(config.ttSize, config.ttFile);
+    OpeningBook book;
+    if (config.book) {
+        book.openForHoles(holesMask(holes));
+    }
+    PatternEvaluator patterns;
+    NetworkEvaluator network;
+    SearchPool pool(config.threads, config.affinity);
+    SearchContext context(config,
+                          saveBestMoveToShmem,
+                          &table,
+                          tracing ? &trace : NULL,
+                          &book,
+                          NULL,
+                          loadEvaluator(config, patterns),
+                          loadNetwork(config, network),
+                          &pool);
+    Strategy strategy(blobs, holes, cplayer, context);
+    shmem_search_started();
     strategy.computeBestMove();
+    shmem_search_done();
     auto end = std::chrono::high_resolution_clock::now();
     auto duration =
         std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
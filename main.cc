@@ -1,4 +1,5 @@
 #include "blobwar.h"
+#include "mapfile.h"
 
 /**
  *	\mainpage Documentation for blobwar
@@ -40,28 +41,130 @@
  *	First of all, all modifications should fit in the strategy.cc
  *	file. In fact, the artificial intelligence is called
  *	by the method computeBestMove() of the strategy class.
- *	When this method returns, the function _saveBestMove should
- *	have been called with the coordinates of the move (from old board cell
- *	to new board cell).
+ *	When this method returns, the SearchContext of the search holds the
+ *	best move found (from old board cell to new board cell), and its
+ *	saveBestMove function has been called with it.
  *
  *	To compute the best move to play, several structures are needed:
- *	-# Strategy::_holes is an array of booleans indicating
- *	for each cell whether it is a hole or not.
+ *	-# Strategy::_board holds one bitboard of blobs per player and the
+ *	bitboard of the holes (see rulescore.h, which also implements the
+ *	moves).
  *	-# Strategy::_current_player is the number of the player who is playing
- *	-# Strategy::_blobs is the array containing all blobs on the board.
  *
  * */
 
 /** this is the main game variable */
 blobwar *game;
 
+/** phase of a computer turn, summed over all turns */
+struct phase_total {
+    const char *name;
+    double total;
+    double max;
+};
+
+/**
+ * ./blobwar --headless: computer games without display.
+ * The turns go through the same path as in the game (rules::compute_move
+ * forks launchStrategy, which sends its move through the shared memory)
+ * and the time of each step of each turn is printed, followed by a
+ * summary telling how much of a turn is spent outside the search.
+ */
+static int headless_games(int argc, char **argv) {
+    int compute_time_IA = 1;
+    Uint32 games = 1;
+    vector<string> maps;
+    for (int i = 2; i < argc; i++) {
+        if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc)) {
+            compute_time_IA = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-games") == 0) && (i + 1 < argc)) {
+            games = atoi(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            maps.push_back(argv[i]);
+        } else {
+            printf("You don't know how to use this ? ./blobwar -h\n");
+            return 1;
+        }
+    }
+    if (compute_time_IA <= 0) compute_time_IA = 1;
+    if (maps.empty()) maps = listMaps();
+
+    EngineConfig config;
+    if (!loadEngineConfig(config, ENGINE_CONFIG_FILE)) {
+        cout << "no " << ENGINE_CONFIG_FILE << ", using default AI" << endl;
+    }
+
+    phase_total phases[5] = {{"spawn", 0, 0},
+                             {"search", 0, 0},
+                             {"exit", 0, 0},
+                             {"shmem read", 0, 0},
+                             {"apply", 0, 0}};
+    Uint32 turns = 0;
+    for (Uint32 g = 0; g < games; g++) {
+        for (string &name : maps) {
+            bidiarray<bool> holes;
+            if (!loadMap(MAPS_DIRECTORY + name, holes)) {
+                cerr << "unable to load map " << name << endl;
+                return 1;
+            }
+
+            rules match(holes, config, compute_time_IA);
+            while (!match.finished) match.compute_move();
+
+            for (turn_timing &t : match.timings) {
+                double steps[5] = {t.spawn, t.search, t.exit, t.read, t.apply};
+                printf("%s turn %u player %u:", name.c_str(), t.turn, t.player);
+                for (Uint8 p = 0; p < 5; p++) {
+                    printf(" %s %.3f", phases[p].name, steps[p]);
+                    phases[p].total += steps[p];
+                    if (steps[p] > phases[p].max) phases[p].max = steps[p];
+                }
+                printf(" ms\n");
+            }
+            turns += match.timings.size();
+            printf("%s: red %u, blue %u\n",
+                   name.c_str(),
+                   match.scores[0],
+                   match.scores[1]);
+        }
+    }
+    if (turns == 0) return 0;
+
+    double total = 0;
+    for (Uint8 p = 0; p < 5; p++) total += phases[p].total;
+    printf("turns: %u, average turn: %.3f ms\n", turns, total / turns);
+    for (Uint8 p = 0; p < 5; p++) {
+        printf("%s: average %.3f ms, max %.3f ms, %.1f%%\n",
+               phases[p].name,
+               phases[p].total / turns,
+               phases[p].max,
+               100 * phases[p].total / total);
+    }
+    printf("outside the search: %.1f%%\n",
+           100 * (total - phases[1].total) / total);
+    return 0;
+}
+
 int main(int argc, char **argv) {
+    if ((argc >= 2) && (strcmp(argv[1], "--headless") == 0)) {
+        return headless_games(argc, argv);
+    }
     if (argc == 2) {
         if (strcmp(argv[1], "-h") == 0) {
             printf("usage: ./blobwar [-t <time>]\n");
+            printf(
+                "       ./blobwar --headless [-t <time>] [-games <n>] "
+                "[map...]\n");
             printf(
                 "	-t <time> let IA compute during <time> (default: "
                 "1).\n");
+            printf(
+                "	--headless play computer games on the maps (default: "
+                "all) without display\n"
+                "	and print the time taken by each step of each turn.\n");
+            printf("	-games <n> games played on each map (default: 1).\n");
+            printf("the AI is configured by %s:\n", ENGINE_CONFIG_FILE);
+            displayEngineUsage();
             exit(0);
         }
     }
@@ -85,6 +188,9 @@ int main(int argc, char **argv) {
     // open video, sound, bugs buffer, ....
     game = new blobwar();
     game->compute_time_IA = compute_time_IA;
+    if (!loadEngineConfig(game->engine_config, ENGINE_CONFIG_FILE)) {
+        cout << "no " << ENGINE_CONFIG_FILE << ", using default AI" << endl;
+    }
 
     // what time is it doc ?
     game->ticks = SDL_GetTicks();
@@ -0,0 +1,57 @@
+#include "mapfile.h"
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <fstream>
+
+bool loadMap(const string& filename, bidiarray<bool>& holes) {
+    ifstream infile(filename.c_str(), ios::in);
+    if (!infile) {
+        return false;
+    }
+
+    char line[9];
+    for (Uint8 i = 0; i < 8; i++) {
+        if (!infile.getline(line, 9, '\n')) {
+            return false;
+        }
+        for (Uint8 j = 0; j < 8; j++) {
+            holes.set(i, j, line[j] == 'x');
+        }
+    }
+    return true;
+}
+
+void initialBlobs(bidiarray<Sint16>& blobs) {
+    for (Uint8 x = 0; x < 8; ++x) {
+        for (Uint8 y = 0; y < 8; ++y) {
+            blobs.set(x, y, -1);
+        }
+    }
+    // same as rules::rules
+    blobs.set(0, 0, 0);
+    blobs.set(7, 0, 0);
+    blobs.set(0, 7, 1);
+    blobs.set(7, 7, 1);
+}
+
+vector<string> listMaps(const string& dirname) {
+    vector<string> maps;
+    DIR* d = opendir(dirname.c_str());
+    if (d == NULL) {
+        return maps;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        // skip hidden files
+        if (entry->d_name[0] != '.') {
+            maps.push_back(entry->d_name);
+        }
+    }
+    closedir(d);
+
+    sort(maps.begin(), maps.end());
+    return maps;
+}
@@ -0,0 +1,25 @@
+#ifndef __MAPFILE_H
+#define __MAPFILE_H
+
+#include "bidiarray.h"
+#include "common.h"
+
+/**
+ * Loading of the board files stored in data/boards without going through
+ * the graphical board class. Used by the command line tools.
+ */
+
+//! directory containing all the maps
+#define MAPS_DIRECTORY "data/boards/"
+
+//! fill holes from the map file (same format as board::load_map)
+//! returns false if the file cannot be read
+bool loadMap(const string& filename, bidiarray<bool>& holes);
+
+//! blobs at the start of a two player game (one in each corner)
+void initialBlobs(bidiarray<Sint16>& blobs);
+
+//! names of all the maps in dirname, sorted so that tools are deterministic
+vector<string> listMaps(const string& dirname = MAPS_DIRECTORY);
+
+#endif
@@ -0,0 +1,416 @@
+#include "mcts.h"
+
+#include <chrono>
+#include <cmath>
+
+//! weight of the exploration term of UCT
+#define MCTS_EXPLORATION 0.7
+
+//! weight of the progressive bias, per point of capture score
+#define MCTS_BIAS 0.05
+
+//! value of a child never visited (before its bias): tried before most
+//! visited ones
+#define MCTS_FIRST_PLAY 1.0
+
+//! a leaf is expanded once it has been visited this number of times
+#define MCTS_EXPAND_VISITS 2
+
+//! rollouts are stopped after this number of plies and scored by the
+//! blobs: random play is too far from real play for long rollouts to tell
+//! anything, they lose most games against alphabeta
+#define MCTS_ROLLOUT_PLIES 2
+
+//! playouts of the first thread between two reports of the best move (a
+//! multiple of ROLLOUT_LANES)
+#define MCTS_REPORT_PLAYOUTS 1024
+
+//! playouts of the first thread between two looks at the clock and the stop
+//! of the search (a multiple of ROLLOUT_LANES)
+#define MCTS_CLOCK_PLAYOUTS 64
+
+//! plies between two searches of a kept tree: the move of the engine and
+//! the reply of the opponent
+#define MCTS_REUSE_PLIES 2
+
+//! capture score of a move of the owner of mine to cell to
+static Uint8 captureScore(Uint64 mine, Uint64 theirs, Uint8 to) {
+    Uint64 near = grow(1ULL << to);
+    return (cellCount(near & theirs) << 1) + ((near & mine) != 0);
+}
+
+MonteCarloTree::MonteCarloTree()
+    : _used(0), _full(false), _stop(false), _playouts(0) {
+    _nodes = new node[MCTS_MAX_NODES];
+}
+
+MonteCarloTree::MonteCarloTree(const boardState& board, Uint16 player)
+    : MonteCarloTree() {
+    reset(board, player);
+}
+
+MonteCarloTree::~MonteCarloTree() { delete[] _nodes; }
+
+void MonteCarloTree::init(node& n, Uint8 from, Uint8 to, Uint8 bias) {
+    n.visits.store(0, memory_order_relaxed);
+    n.wins.store(0, memory_order_relaxed);
+    n.children = 0;
+    n.childCount = 0;
+    n.from = from;
+    n.to = to;
+    n.bias = bias;
+    n.state.store(LEAF, memory_order_relaxed);
+}
+
+void MonteCarloTree::reset(const boardState& board, Uint16 player) {
+    _used.store(1);
+    _full.store(false);
+    _holes = board.holes;
+    _blobs[0] = board.blobs[0];
+    _blobs[1] = board.blobs[1];
+    _player = player;
+    init(_nodes[0], PASS, PASS, 0);
+}
+
+void MonteCarloTree::find(Uint32 index,
+                          const Uint64 blobs[2],
+                          Uint16 player,
+                          const boardState& board,
+                          Uint16 boardPlayer,
+                          Uint32 plies,
+                          Uint32& found) const {
+    const node& n = _nodes[index];
+    if (player == boardPlayer && blobs[0] == board.blobs[0] &&
+        blobs[1] == board.blobs[1]) {
+        Uint32 visits = n.visits.load(memory_order_relaxed);
+        if (found == NONE ||
+            visits > _nodes[found].visits.load(memory_order_relaxed)) {
+            found = index;
+        }
+        return;
+    }
+    if (plies == 0 || n.state.load(memory_order_relaxed) != EXPANDED) {
+        return;
+    }
+    for (Uint32 i = n.children; i < n.children + n.childCount; ++i) {
+        Uint64 next[2] = {blobs[0], blobs[1]};
+        if (_nodes[i].from != PASS) {
+            play(next, player, _nodes[i].from, _nodes[i].to);
+        }
+        find(i, next, player ^ 1, board, boardPlayer, plies - 1, found);
+    }
+}
+
+void MonteCarloTree::compact(Uint32 root) {
+    Uint32 used = min(_used.load(), (Uint32)MCTS_MAX_NODES);
+
+    // mark: children always come after their parent, so one pass from the
+    // root finds its whole subtree
+    vector<Uint32> forward(used, NONE);
+    forward[root] = 0;
+    for (Uint32 i = root; i < used; ++i) {
+        const node& n = _nodes[i];
+        if (forward[i] != NONE &&
+            n.state.load(memory_order_relaxed) == EXPANDED) {
+            for (Uint32 c = n.children; c < n.children + n.childCount; ++c) {
+                forward[c] = 0;
+            }
+        }
+    }
+
+    // slide the marked nodes to the start of the array, in order: a node
+    // only moves down, over nodes already moved or dropped, and the
+    // children of a node stay next to each other
+    Uint32 next = 0;
+    for (Uint32 i = root; i < used; ++i) {
+        if (forward[i] != NONE) {
+            forward[i] = next++;
+        }
+    }
+    for (Uint32 i = root; i < used; ++i) {
+        if (forward[i] == NONE) {
+            continue;
+        }
+        const node& n = _nodes[i];
+        node& m = _nodes[forward[i]];
+        Uint8 state = n.state.load(memory_order_relaxed);
+        m.visits.store(n.visits.load(memory_order_relaxed),
+                       memory_order_relaxed);
+        m.wins.store(n.wins.load(memory_order_relaxed), memory_order_relaxed);
+        // (a node without moves may point past the last node)
+        m.children = n.childCount != 0 ? forward[n.children] : 0;
+        m.childCount = n.childCount;
+        m.from = n.from;
+        m.to = n.to;
+        m.bias = n.bias;
+        m.state.store(state, memory_order_relaxed);
+    }
+    _used.store(next);
+    _full.store(false);
+}
+
+Uint32 MonteCarloTree::reroot(const boardState& board, Uint16 player) {
+    Uint32 root = NONE;
+    if (_used.load() != 0 && board.holes == _holes) {
+        find(0, _blobs, _player, board, player, MCTS_REUSE_PLIES, root);
+    }
+    if (root == NONE) {
+        reset(board, player);
+        return 0;
+    }
+
+    compact(root);
+    _blobs[0] = board.blobs[0];
+    _blobs[1] = board.blobs[1];
+    _player = player;
+    return _nodes[0].visits.load(memory_order_relaxed);
+}
+
+void MonteCarloTree::play(Uint64 blobs[2],
+                          Uint16 player,
+                          Uint8 from,
+                          Uint8 to) {
+    Uint64 destination = 1ULL << to;
+    Uint64 near = grow(destination);
+    if (!(near & (1ULL << from))) {
+        blobs[player] &= ~(1ULL << from);
+    }
+    Uint64 captured = blobs[player ^ 1] & near;
+    blobs[player] |= captured | destination;
+    blobs[player ^ 1] &= ~captured;
+}
+
+bool MonteCarloTree::expand(node& n, const Uint64 blobs[2], Uint16 player) {
+    Uint8 leaf = LEAF;
+    if (_full.load(memory_order_relaxed) ||
+        !n.state.compare_exchange_strong(leaf, EXPANDING)) {
+        return false;
+    }
+
+    // a copy per destination (copies to the same cell give the same
+    // position) and a jump per origin, none once a player has no blobs
+    Uint64 mine = blobs[player];
+    Uint64 theirs = blobs[player ^ 1];
+    Uint64 empty = ~(mine | theirs | _holes);
+    Uint64 targets = mine != 0 && theirs != 0 ? reach(mine) & empty : 0;
+    Uint32 count = 0;
+    for (Uint64 t = targets; t; t &= t - 1) {
+        Uint64 cell = 1ULL << firstCell(t);
+        Uint64 near = grow(cell);
+        count += ((near & mine) != 0) + cellCount(reach(cell) & ~near & mine);
+    }
+    bool pass = count == 0 && mine != 0 && theirs != 0 &&
+                (reach(theirs) & empty) != 0;
+    count += pass;
+
+    Uint32 first = _used.fetch_add(count);
+    if (first + count > MCTS_MAX_NODES) {
+        _full.store(true, memory_order_relaxed);
+        n.state.store(LEAF, memory_order_relaxed);
+        return false;
+    }
+
+    Uint32 i = first;
+    auto add = [&](Uint8 from, Uint8 to, Uint8 bias) {
+        init(_nodes[i++], from, to, bias);
+    };
+    for (; targets; targets &= targets - 1) {
+        Uint8 to = firstCell(targets);
+        Uint64 near = grow(1ULL << to);
+        Uint8 bias = captureScore(mine, theirs, to);
+        if (near & mine) {
+            add(firstCell(near & mine), to, bias);
+        }
+        for (Uint64 origins = reach(1ULL << to) & ~near & mine; origins;
+             origins &= origins - 1) {
+            add(firstCell(origins), to, bias);
+        }
+    }
+    if (pass) {
+        add(PASS, PASS, 0);
+    }
+
+    n.children = first;
+    n.childCount = count;
+    n.state.store(EXPANDED, memory_order_release);
+    return true;
+}
+
+Uint32 MonteCarloTree::select(const node& n) const {
+    double logVisits =
+        log((double)max(n.visits.load(memory_order_relaxed), 1u));
+    Uint32 best = n.children;
+    double bestValue = -1;
+    for (Uint32 i = n.children; i < n.children + n.childCount; ++i) {
+        const node& c = _nodes[i];
+        Uint32 visits = c.visits.load(memory_order_relaxed);
+        double value = MCTS_FIRST_PLAY + MCTS_BIAS * c.bias;
+        if (visits != 0) {
+            value = c.wins.load(memory_order_relaxed) / (2.0 * visits) +
+                    MCTS_EXPLORATION * sqrt(logVisits / visits) +
+                    MCTS_BIAS * c.bias / (visits + 1);
+        }
+        if (value > bestValue) {
+            bestValue = value;
+            best = i;
+        }
+    }
+    return best;
+}
+
+Uint32 MonteCarloTree::descend(Uint32 path[MCTS_MAX_PATH],
+                               Uint64 blobs[2],
+                               Uint16& player,
+                               SearchStats& stats) {
+    // the visits are counted on the way down (virtual loss)
+    Uint32 length = 0;
+    node* n = &_nodes[0];
+    n->visits.fetch_add(1, memory_order_relaxed);
+    path[length++] = 0;
+    for (;;) {
+        ++stats.nodes;
+        if (n->state.load(memory_order_acquire) != EXPANDED &&
+            (n->visits.load(memory_order_relaxed) < MCTS_EXPAND_VISITS ||
+             !expand(*n, blobs, player))) {
+            break;
+        }
+        if (n->childCount == 0 || length == MCTS_MAX_PATH) {
+            break;
+        }
+        Uint32 c = select(*n);
+        n = &_nodes[c];
+        n->visits.fetch_add(1, memory_order_relaxed);
+        path[length++] = c;
+        if (n->from != PASS) {
+            play(blobs, player, n->from, n->to);
+        }
+        player ^= 1;
+    }
+    return length;
+}
+
+void MonteCarloTree::backup(const Uint32 path[MCTS_MAX_PATH],
+                            Uint32 length,
+                            Uint16 winner) {
+    // a node counts the results of the player who moved to it
+    Uint16 mover = _player ^ 1;
+    for (Uint32 i = 0; i < length; ++i) {
+        _nodes[path[i]].wins.fetch_add(
+            winner == 2 ? 1 : winner == mover ? 2 : 0, memory_order_relaxed);
+        mover ^= 1;
+    }
+}
+
+void MonteCarloTree::playouts(RolloutBatch& batch, SearchStats& stats) {
+    Uint32 paths[ROLLOUT_LANES][MCTS_MAX_PATH];
+    Uint32 lengths[ROLLOUT_LANES];
+    Uint16 players[ROLLOUT_LANES];
+    for (Uint32 lane = 0; lane < ROLLOUT_LANES; ++lane) {
+        Uint64 blobs[2] = {_blobs[0], _blobs[1]};
+        Uint16 player = _player;
+        lengths[lane] = descend(paths[lane], blobs, player, stats);
+        players[lane] = player;
+        batch.mine[lane] = blobs[player];
+        batch.theirs[lane] = blobs[player ^ 1];
+    }
+
+    stats.nodes += playRollouts(batch, _holes, MCTS_ROLLOUT_PLIES);
+#ifdef _STAT
+    stats.leaves += ROLLOUT_LANES;
+#endif
+
+    for (Uint32 lane = 0; lane < ROLLOUT_LANES; ++lane) {
+        Sint64 result = batch.result[lane];
+        Uint16 winner = result > 0   ? players[lane]
+                        : result < 0 ? players[lane] ^ 1
+                                     : 2;
+        backup(paths[lane], lengths[lane], winner);
+    }
+}
+
+void MonteCarloTree::run(Uint64 seed, SearchStats* stats) {
+    RolloutBatch batch;
+    batch.seed(seed);
+    while (!_stop.load(memory_order_relaxed)) {
+        playouts(batch, *stats);
+        if (_playouts.fetch_add(ROLLOUT_LANES) + ROLLOUT_LANES >= _budget) {
+            _stop.store(true, memory_order_relaxed);
+        }
+    }
+}
+
+bool MonteCarloTree::best(movement& mv, Sint32& score) const {
+    const node& root = _nodes[0];
+    Uint32 mostVisits = 0;
+    for (Uint32 i = root.children; i < root.children + root.childCount; ++i) {
+        const node& c = _nodes[i];
+        Uint32 visits = c.visits.load(memory_order_relaxed);
+        if (c.from != PASS && visits > mostVisits) {
+            mostVisits = visits;
+            mv = movement(c.from >> 3, c.from & 7, c.to >> 3, c.to & 7);
+            score = (Sint32)(c.wins.load(memory_order_relaxed) * 50 / visits) -
+                    50;
+        }
+    }
+    return mostVisits != 0;
+}
+
+Sint32 MonteCarloTree::search(
+    Uint32 time,
+    SearchPool& pool,
+    Uint32 threads,
+    Uint64 seed,
+    SearchStats& stats,
+    const std::function<void(const movement&, Sint32)>& improved,
+    const std::function<bool()>& stop) {
+    _stop.store(false);
+    _playouts.store(0);
+    expand(_nodes[0], _blobs, _player);
+    _budget = time == 0 ? MCTS_PLAYOUTS : UINT32_MAX;
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(time);
+
+    // every thread has its own random generator and counters
+    threads = max(min(threads, pool.size()), 1u);
+    vector<SearchStats> threadStats(threads);
+    movement mv;
+    Sint32 score = 0;
+    pool.run(threads, [&](Uint32 worker) {
+        if (worker != 0) {
+            run(seed + worker * 0x9e3779b97f4a7c15ULL, &threadStats[worker]);
+            return;
+        }
+        // the first thread plays too, watches the clock and reports the
+        // best move whenever it changes
+        RolloutBatch batch;
+        batch.seed(seed);
+        movement reported;
+        bool hasReported = false;
+        for (Uint32 n = ROLLOUT_LANES; !_stop.load(memory_order_relaxed);
+             n += ROLLOUT_LANES) {
+            playouts(batch, threadStats[0]);
+            if (_playouts.fetch_add(ROLLOUT_LANES) + ROLLOUT_LANES >=
+                    _budget ||
+                (n % MCTS_CLOCK_PLAYOUTS == 0 &&
+                 ((time != 0 &&
+                   std::chrono::steady_clock::now() >= deadline) ||
+                  (stop && stop())))) {
+                _stop.store(true, memory_order_relaxed);
+            }
+            if (n % MCTS_REPORT_PLAYOUTS == 0 && best(mv, score) &&
+                (!hasReported || !(mv == reported))) {
+                improved(mv, score);
+                reported = mv;
+                hasReported = true;
+            }
+        }
+    });
+    for (auto& s : threadStats) {
+        stats.add(s);
+    }
+
+    if (best(mv, score)) {
+        improved(mv, score);
+    }
+    return score;
+}
@@ -0,0 +1,185 @@
+#ifndef __MCTS_H
+#define __MCTS_H
+
+#include <atomic>
+#include <functional>
+
+#include "SDL_stdinc.h"
+#include "move.h"
+#include "rollout.h"
+#include "rulescore.h"
+#include "searchpool.h"
+#include "searchstats.h"
+
+//! number of nodes of the tree, a full tree is not expanded any more
+#define MCTS_MAX_NODES (1 << 21)
+
+//! playouts of a search without time budget
+#define MCTS_PLAYOUTS 20000
+
+//! deepest path followed in the tree
+#define MCTS_MAX_PATH 256
+
+/**
+ * Monte Carlo tree search of a two player game (UCT).
+ * Each playout walks down the tree to a leaf, expands it once it has been
+ * visited, plays a few random plies on bitboards (to the end of the game
+ * at most) and counts the result, which player has more blobs (not the
+ * margin), in the nodes it crossed. A thread walks down to ROLLOUT_LANES
+ * leaves before playing their rollouts together (see playRollouts).
+ *
+ * A child is chosen by its win rate, plus the UCT exploration term, plus a
+ * progressive bias: the capture score of its move (captures and copies)
+ * divided by its visits, so that good looking moves are tried first and
+ * the results take over once they are known.
+ *
+ * Threads share the tree (tree parallelism). A thread counts its visit in
+ * the nodes of its path as soon as it selects them and adds the result
+ * only at the end of the playout: until then the path looks like a loss
+ * (virtual loss), which sends the other threads elsewhere. Nodes are
+ * taken from one array, a leaf being expanded by the thread which marks
+ * it first.
+ *
+ * A tree can be kept from one move of a game to the next (see reroot): the
+ * subtree of the new position, two plies below the old root, becomes the
+ * tree with the playouts already done in it, and the rest of the array is
+ * collected by sliding the kept nodes to its start.
+ */
+class MonteCarloTree {
+   private:
+    //! the move of a pass (a player who cannot move while the other can)
+    static const Uint8 PASS = 64;
+
+    //! node states
+    static const Uint8 LEAF = 0;
+    static const Uint8 EXPANDING = 1;
+    static const Uint8 EXPANDED = 2;
+
+    //! no node
+    static const Uint32 NONE = 0xffffffff;
+
+    struct node {
+        //! playouts through the node, including those still running
+        std::atomic<Uint32> visits;
+        //! results of the finished playouts for the player who played the
+        //! move of the node: 2 per win, 1 per draw
+        std::atomic<Uint32> wins;
+        //! index of the first child, valid once expanded
+        Uint32 children;
+        Uint16 childCount;
+        //! cells of the move, x * 8 + y (PASS for a pass)
+        Uint8 from;
+        Uint8 to;
+        //! capture score of the move (2 per capture, 1 for a copy)
+        Uint8 bias;
+        //! LEAF, EXPANDING or EXPANDED
+        std::atomic<Uint8> state;
+    };
+
+    node* _nodes;
+    //! nodes given to the tree so far (may go past MCTS_MAX_NODES), the
+    //! root is node 0 and children always come after their parent
+    std::atomic<Uint32> _used;
+    //! no node is left
+    std::atomic<bool> _full;
+
+    Uint64 _holes;
+    //! blobs of the position of the root
+    Uint64 _blobs[2];
+    //! player to move at the root
+    Uint16 _player;
+
+    //! the threads stop when it is set
+    std::atomic<bool> _stop;
+    //! playouts started by all the threads, and their limit
+    std::atomic<Uint32> _playouts;
+    Uint32 _budget;
+
+    //! a node without visits nor children for the move from -> to
+    static void init(node& n, Uint8 from, Uint8 to, Uint8 bias);
+
+    //! start a tree with only the root
+    void reset(const boardState& board, Uint16 player);
+
+    /**
+     * Look for the position of board and boardPlayer in the subtree of
+     * index (position of blobs and player) down to plies plies below it,
+     * found is set to the node with the most visits.
+     */
+    void find(Uint32 index,
+              const Uint64 blobs[2],
+              Uint16 player,
+              const boardState& board,
+              Uint16 boardPlayer,
+              Uint32 plies,
+              Uint32& found) const;
+
+    //! make the subtree of root the tree and free all other nodes
+    void compact(Uint32 root);
+
+    //! give the moves of the position to node, false if someone else
+    //! does or there is no room left
+    bool expand(node& n, const Uint64 blobs[2], Uint16 player);
+
+    //! child of n to follow
+    Uint32 select(const node& n) const;
+
+    //! play the move from -> to of player
+    static void play(Uint64 blobs[2], Uint16 player, Uint8 from, Uint8 to);
+
+    /**
+     * Walk down from the root to the leaf to play out, expanding it if it
+     * has been visited enough. Returns the length of its path, blobs and
+     * player are set to its position.
+     */
+    Uint32 descend(Uint32 path[MCTS_MAX_PATH],
+                   Uint64 blobs[2],
+                   Uint16& player,
+                   SearchStats& stats);
+
+    //! count the result of a playout (2 for a draw) in the nodes of path
+    void backup(const Uint32 path[MCTS_MAX_PATH], Uint32 length, Uint16 winner);
+
+    //! ROLLOUT_LANES playouts from the root, rolled out at once in batch
+    void playouts(RolloutBatch& batch, SearchStats& stats);
+
+    //! run playouts until the search stops
+    void run(Uint64 seed, SearchStats* stats);
+
+    //! most visited child of the root, false if the root has none yet
+    bool best(movement& mv, Sint32& score) const;
+
+   public:
+    //! empty tree, to be given a position with reroot
+    MonteCarloTree();
+    //! search of the position for player
+    MonteCarloTree(const boardState& board, Uint16 player);
+    ~MonteCarloTree();
+
+    /**
+     * Search the position of board for player next, keeping the subtree of
+     * this position if it is found at most two plies below the root (the
+     * previous search of the engine, then its move and the reply), or
+     * starting over if it is not.
+     * Returns the playouts kept.
+     */
+    Uint32 reroot(const boardState& board, Uint16 player);
+
+    /**
+     * Search for time ms (MCTS_PLAYOUTS playouts if 0) on threads threads
+     * of pool, counting the positions visited in stats. improved is called
+     * with the most visited move whenever it changes, so that a search
+     * interrupted early still has a move, and at the end. The search also
+     * ends as soon as stop (if any) returns true.
+     * Returns the score of the move: its win rate, in percents above 50.
+     */
+    Sint32 search(Uint32 time,
+                  SearchPool& pool,
+                  Uint32 threads,
+                  Uint64 seed,
+                  SearchStats& stats,
+                  const std::function<void(const movement&, Sint32)>& improved,
+                  const std::function<bool()>& stop = nullptr);
+};
+
+#endif
@@ -27,6 +27,10 @@ struct movement {
         return *this;
     }
 
+    bool operator==(const movement& mv) const {
+        return ox == mv.ox && oy == mv.oy && nx == mv.nx && ny == mv.ny;
+    }
+
     Uint8 distance() const { return std::max(abs(nx - ox), abs(ny - oy)); }
 
     Uint8 ox;
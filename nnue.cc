@@ -0,0 +1,313 @@
+#include "nnue.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "rulescore.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NETWORK_AVX2
+#endif
+
+//! output of the second layer (in NETWORK_ONE * NETWORK_WEIGHT_ONE) to an
+//! activation
+static inline Uint8 activation(Sint32 sum) {
+    Sint32 a = sum / NETWORK_WEIGHT_ONE;
+    return a < 0 ? 0 : a > NETWORK_ONE ? NETWORK_ONE : a;
+}
+
+//! the last layer of the activations of the second one plus the blob
+//! difference of player, in points
+static inline Sint32 output(const NetworkWeights& w,
+                            const NetworkAccumulator& accumulator,
+                            Uint16 player,
+                            const Uint8 hidden[NETWORK_LAYER]) {
+    Sint32 sum = w.outputBias;
+    for (Uint32 i = 0; i < NETWORK_LAYER; ++i) {
+        sum += hidden[i] * w.output[i];
+    }
+    Sint32 material = accumulator.blobs[player] - accumulator.blobs[player ^ 1];
+    return sum * NETWORK_SCALE / (NETWORK_ONE * NETWORK_WEIGHT_ONE) +
+           material * NETWORK_SCALE;
+}
+
+//! the blob counts of next after a move of player (see update)
+static inline void updateBlobs(const NetworkAccumulator& current,
+                               NetworkAccumulator& next,
+                               Uint16 player,
+                               Uint64 added,
+                               Uint64 removed,
+                               Uint64 captured) {
+    Sint16 taken = cellCount(captured);
+    next.blobs[player] = current.blobs[player] + cellCount(added) -
+                         cellCount(removed) + taken;
+    next.blobs[player ^ 1] = current.blobs[player ^ 1] - taken;
+}
+
+NetworkEvaluator::NetworkEvaluator() {
+    memset(&_weights, 0, sizeof(_weights));
+}
+
+void NetworkEvaluator::refresh(Uint64 blobs0,
+                               Uint64 blobs1,
+                               Uint64 holes,
+                               NetworkAccumulator& accumulator) const {
+    for (Uint16 player = 0; player < 2; ++player) {
+        Sint16* values = accumulator.values[player];
+        memcpy(values, _weights.inputBias, sizeof(_weights.inputBias));
+        Uint64 planes[3] = {player == 0 ? blobs0 : blobs1,
+                            player == 0 ? blobs1 : blobs0,
+                            holes};
+        accumulator.blobs[player] = cellCount(planes[0]);
+        for (Uint32 plane = 0; plane < 3; ++plane) {
+            for (Uint64 cells = planes[plane]; cells; cells &= cells - 1) {
+                const Sint16* row =
+                    _weights.input[plane * 64 + firstCell(cells)];
+                for (Uint32 i = 0; i < NETWORK_HIDDEN; ++i) {
+                    values[i] += row[i];
+                }
+            }
+        }
+    }
+}
+
+void NetworkEvaluator::updateScalar(const NetworkAccumulator& current,
+                                    NetworkAccumulator& next,
+                                    Uint16 player,
+                                    Uint64 added,
+                                    Uint64 removed,
+                                    Uint64 captured) const {
+    updateBlobs(current, next, player, added, removed, captured);
+    for (Uint16 view = 0; view < 2; ++view) {
+        // the blobs of player are its own from its point of view
+        Uint32 own = view == player ? NETWORK_OWN : NETWORK_OTHER;
+        Uint32 other = view == player ? NETWORK_OTHER : NETWORK_OWN;
+        const Sint16* from = current.values[view];
+        Sint16* to = next.values[view];
+        memcpy(to, from, sizeof(current.values[view]));
+        for (Uint64 cells = added | captured; cells; cells &= cells - 1) {
+            const Sint16* row = _weights.input[own + firstCell(cells)];
+            for (Uint32 i = 0; i < NETWORK_HIDDEN; ++i) {
+                to[i] += row[i];
+            }
+        }
+        for (Uint64 cells = removed; cells; cells &= cells - 1) {
+            const Sint16* row = _weights.input[own + firstCell(cells)];
+            for (Uint32 i = 0; i < NETWORK_HIDDEN; ++i) {
+                to[i] -= row[i];
+            }
+        }
+        for (Uint64 cells = captured; cells; cells &= cells - 1) {
+            const Sint16* row = _weights.input[other + firstCell(cells)];
+            for (Uint32 i = 0; i < NETWORK_HIDDEN; ++i) {
+                to[i] -= row[i];
+            }
+        }
+    }
+}
+
+Sint32 NetworkEvaluator::evaluateScalar(const NetworkAccumulator& accumulator,
+                                        Uint16 player) const {
+    // the first layer of the player to move comes first
+    Uint8 inputs[2 * NETWORK_HIDDEN];
+    for (Uint32 side = 0; side < 2; ++side) {
+        const Sint16* values = accumulator.values[player ^ side];
+        for (Uint32 i = 0; i < NETWORK_HIDDEN; ++i) {
+            Sint16 v = values[i];
+            inputs[side * NETWORK_HIDDEN + i] =
+                v < 0 ? 0 : v > NETWORK_ONE ? NETWORK_ONE : v;
+        }
+    }
+
+    Uint8 hidden[NETWORK_LAYER];
+    for (Uint32 n = 0; n < NETWORK_LAYER; ++n) {
+        Sint32 sum = _weights.layerBias[n];
+        for (Uint32 i = 0; i < 2 * NETWORK_HIDDEN; ++i) {
+            sum += inputs[i] * _weights.layer[n][i];
+        }
+        hidden[n] = activation(sum);
+    }
+    return output(_weights, accumulator, player, hidden);
+}
+
+#ifdef NETWORK_AVX2
+
+#define AVX2 __attribute__((target("avx2")))
+
+//! registers of 16 values of the first layer, of a point of view
+#define NETWORK_REGISTERS (NETWORK_HIDDEN / 16)
+//! registers of 32 activations of the first layer, of both
+#define NETWORK_INPUT_REGISTERS (2 * NETWORK_HIDDEN / 32)
+
+AVX2 static inline void addRow(__m256i values[NETWORK_REGISTERS],
+                               const Sint16* row) {
+    for (Uint32 r = 0; r < NETWORK_REGISTERS; ++r) {
+        values[r] = _mm256_add_epi16(
+            values[r], _mm256_load_si256((const __m256i*)row + r));
+    }
+}
+
+AVX2 static inline void subtractRow(__m256i values[NETWORK_REGISTERS],
+                                    const Sint16* row) {
+    for (Uint32 r = 0; r < NETWORK_REGISTERS; ++r) {
+        values[r] = _mm256_sub_epi16(
+            values[r], _mm256_load_si256((const __m256i*)row + r));
+    }
+}
+
+//! updateScalar with the accumulator of a point of view in registers
+AVX2 static void updateAvx2(const NetworkWeights& w,
+                            const NetworkAccumulator& current,
+                            NetworkAccumulator& next,
+                            Uint16 player,
+                            Uint64 added,
+                            Uint64 removed,
+                            Uint64 captured) {
+    updateBlobs(current, next, player, added, removed, captured);
+    for (Uint16 view = 0; view < 2; ++view) {
+        Uint32 own = view == player ? NETWORK_OWN : NETWORK_OTHER;
+        Uint32 other = view == player ? NETWORK_OTHER : NETWORK_OWN;
+        __m256i values[NETWORK_REGISTERS];
+        for (Uint32 r = 0; r < NETWORK_REGISTERS; ++r) {
+            values[r] =
+                _mm256_load_si256((const __m256i*)current.values[view] + r);
+        }
+        for (Uint64 cells = added | captured; cells; cells &= cells - 1) {
+            addRow(values, w.input[own + firstCell(cells)]);
+        }
+        for (Uint64 cells = removed; cells; cells &= cells - 1) {
+            subtractRow(values, w.input[own + firstCell(cells)]);
+        }
+        for (Uint64 cells = captured; cells; cells &= cells - 1) {
+            subtractRow(values, w.input[other + firstCell(cells)]);
+        }
+        for (Uint32 r = 0; r < NETWORK_REGISTERS; ++r) {
+            _mm256_store_si256((__m256i*)next.values[view] + r, values[r]);
+        }
+    }
+}
+
+//! sum of the 8 lanes of x
+AVX2 static inline Sint32 horizontalSum(__m256i x) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(x),
+                                _mm256_extracti128_si256(x, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+/**
+ * evaluateScalar with the activations of the first layer in bytes: the
+ * products of an activation (at most 127) and a weight (8 bits) are summed
+ * by pairs in 16 bits without saturation (maddubs), then in 32 bits.
+ */
+AVX2 static Sint32 evaluateAvx2(const NetworkWeights& w,
+                                const NetworkAccumulator& accumulator,
+                                Uint16 player) {
+    const __m256i one = _mm256_set1_epi16(NETWORK_ONE);
+    const __m256i pairs = _mm256_set1_epi16(1);
+    __m256i inputs[NETWORK_INPUT_REGISTERS];
+    for (Uint32 side = 0; side < 2; ++side) {
+        const __m256i* values =
+            (const __m256i*)accumulator.values[player ^ side];
+        for (Uint32 r = 0; r < NETWORK_REGISTERS; r += 2) {
+            // packus clips to [0, 255] and interleaves the 128 bit lanes
+            // of its operands, the permutation puts them back in order
+            __m256i low = _mm256_min_epi16(_mm256_load_si256(values + r), one);
+            __m256i high =
+                _mm256_min_epi16(_mm256_load_si256(values + r + 1), one);
+            inputs[(side * NETWORK_REGISTERS + r) / 2] =
+                _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xd8);
+        }
+    }
+
+    Uint8 hidden[NETWORK_LAYER];
+    for (Uint32 n = 0; n < NETWORK_LAYER; ++n) {
+        const __m256i* weights = (const __m256i*)w.layer[n];
+        __m256i sum = _mm256_setzero_si256();
+        for (Uint32 r = 0; r < NETWORK_INPUT_REGISTERS; ++r) {
+            __m256i products = _mm256_maddubs_epi16(
+                inputs[r], _mm256_load_si256(weights + r));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, pairs));
+        }
+        hidden[n] = activation(w.layerBias[n] + horizontalSum(sum));
+    }
+    return output(w, accumulator, player, hidden);
+}
+
+#endif
+
+void NetworkEvaluator::update(const NetworkAccumulator& current,
+                              NetworkAccumulator& next,
+                              Uint16 player,
+                              Uint64 added,
+                              Uint64 removed,
+                              Uint64 captured) const {
+#ifdef NETWORK_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) {
+        updateAvx2(_weights, current, next, player, added, removed, captured);
+        return;
+    }
+#endif
+    updateScalar(current, next, player, added, removed, captured);
+}
+
+Sint32 NetworkEvaluator::evaluate(const NetworkAccumulator& accumulator,
+                                  Uint16 player) const {
+#ifdef NETWORK_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) {
+        return evaluateAvx2(_weights, accumulator, player);
+    }
+#endif
+    return evaluateScalar(accumulator, player);
+}
+
+Sint32 NetworkEvaluator::evaluate(Uint64 mine,
+                                  Uint64 theirs,
+                                  Uint64 holes) const {
+    NetworkAccumulator accumulator;
+    refresh(mine, theirs, holes, accumulator);
+    return evaluate(accumulator, 0);
+}
+
+bool NetworkEvaluator::load(const string& filename) {
+    ifstream infile(filename.c_str(), ios::in | ios::binary);
+    NetworkHeader header;
+    if (!infile.read((char*)&header, sizeof(header)) ||
+        header.magic != NETWORK_MAGIC || header.version != NETWORK_VERSION ||
+        header.hidden != NETWORK_HIDDEN || header.layer != NETWORK_LAYER) {
+        return false;
+    }
+    NetworkWeights w;
+    if (!infile.read((char*)w.input, sizeof(w.input)) ||
+        !infile.read((char*)w.inputBias, sizeof(w.inputBias)) ||
+        !infile.read((char*)w.layer, sizeof(w.layer)) ||
+        !infile.read((char*)w.layerBias, sizeof(w.layerBias)) ||
+        !infile.read((char*)w.output, sizeof(w.output)) ||
+        !infile.read((char*)&w.outputBias, sizeof(w.outputBias))) {
+        return false;
+    }
+    _weights = w;
+    return true;
+}
+
+bool NetworkEvaluator::write(const string& filename) const {
+    ofstream outfile(filename.c_str(), ios::out | ios::binary);
+    if (!outfile) {
+        return false;
+    }
+    NetworkHeader header = {
+        NETWORK_MAGIC, NETWORK_VERSION, NETWORK_HIDDEN, NETWORK_LAYER};
+    const NetworkWeights& w = _weights;
+    outfile.write((const char*)&header, sizeof(header));
+    outfile.write((const char*)w.input, sizeof(w.input));
+    outfile.write((const char*)w.inputBias, sizeof(w.inputBias));
+    outfile.write((const char*)w.layer, sizeof(w.layer));
+    outfile.write((const char*)w.layerBias, sizeof(w.layerBias));
+    outfile.write((const char*)w.output, sizeof(w.output));
+    outfile.write((const char*)&w.outputBias, sizeof(w.outputBias));
+    return (bool)outfile;
+}
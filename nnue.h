@@ -0,0 +1,149 @@
+#ifndef __NNUE_H
+#define __NNUE_H
+
+#include "SDL_stdinc.h"
+#include "common.h"
+
+//! file of the network loaded by default
+#define NETWORK_FILE "data/eval/network.weights"
+
+//! first bytes of a network file ("blobnnue" read as a little-endian word)
+#define NETWORK_MAGIC 0x65756e6e626f6c62ULL
+//! version of the format, changes with the file layout or the inputs
+#define NETWORK_VERSION 1
+
+/*
+ * Inputs of the network for the point of view of a player: the cells of
+ * its blobs, then those of the blobs of the other player, then the holes.
+ */
+#define NETWORK_OWN 0
+#define NETWORK_OTHER 64
+#define NETWORK_HOLES 128
+#define NETWORK_INPUTS 192
+
+//! neurons of the first layer, for each point of view (the accumulator)
+#define NETWORK_HIDDEN 64
+//! neurons of the second layer, fed by the two points of view
+#define NETWORK_LAYER 16
+
+//! quantization: an activation of 1 is NETWORK_ONE (activations are
+//! clipped to [0, 1]), a weight of 1 of the second and last layers is
+//! NETWORK_WEIGHT_ONE (those of the first layer are in activations)
+#define NETWORK_ONE 127
+#define NETWORK_WEIGHT_ONE 64
+
+//! points of the evaluation per blob, as the patterns (PATTERN_SCALE): the
+//! network outputs blobs, added to the blob difference
+#define NETWORK_SCALE 16
+
+/**
+ * Output of the first layer for the two points of view, before its
+ * activation: the sum of the weights of the inputs which are set, updated
+ * with the cells a move changes instead of being computed again.
+ */
+struct NetworkAccumulator {
+    //! by player of the point of view
+    alignas(32) Sint16 values[2][NETWORK_HIDDEN];
+    //! number of blobs of each player
+    Sint16 blobs[2];
+};
+
+//! the quantized weights of the network
+struct NetworkWeights {
+    //! first layer, by input, then its biases
+    alignas(32) Sint16 input[NETWORK_INPUTS][NETWORK_HIDDEN];
+    alignas(32) Sint16 inputBias[NETWORK_HIDDEN];
+    //! second layer, by neuron: the accumulator of the player to move,
+    //! then the other one
+    alignas(32) Sint8 layer[NETWORK_LAYER][2 * NETWORK_HIDDEN];
+    Sint32 layerBias[NETWORK_LAYER];
+    //! last layer, to a single output
+    Sint16 output[NETWORK_LAYER];
+    Sint32 outputBias;
+};
+
+//! start of a network file, followed by the arrays of NetworkWeights in
+//! order
+struct NetworkHeader {
+    Uint64 magic;
+    Uint32 version;
+    //! NETWORK_HIDDEN and NETWORK_LAYER
+    Uint16 hidden;
+    Uint16 layer;
+};
+
+/**
+ * Evaluation of a position by a small neural network, an alternative to
+ * the blob difference and the patterns (see EngineConfig::evaluation).
+ * The first layer sees the board from the point of view of each player
+ * (NETWORK_INPUTS inputs of 0 or 1), the second one the clipped outputs of
+ * the first layer for the player to move and the other one, the last one
+ * gives what the network adds to the blob difference: it learns what
+ * material misses, and the search still sees every capture.
+ * The search keeps the first layer in an accumulator: a move only adds and
+ * subtracts the weights of the cells it changes (see update), the other
+ * layers are computed at the leaves.
+ * The weights are in 16 bits for the first layer and 8 bits for the
+ * second one, whose products are summed on AVX2 when the processor has
+ * it, and by scalar code otherwise (with the same results).
+ * The weights are trained offline by tuneEval.
+ */
+class NetworkEvaluator {
+   private:
+    NetworkWeights _weights;
+
+   public:
+    //! all weights 0
+    NetworkEvaluator();
+
+    /**
+     * Load the weights of filename, returns false (and keeps the weights)
+     * if it cannot be read or is not a network file of this version.
+     */
+    bool load(const string& filename);
+
+    //! write the weights to filename, returns false if it cannot be written
+    bool write(const string& filename) const;
+
+    const NetworkWeights& weights() const { return _weights; }
+    void setWeights(const NetworkWeights& weights) { _weights = weights; }
+
+    //! first layer of the position of the blobs of players 0 and 1
+    void refresh(Uint64 blobs0,
+                 Uint64 blobs1,
+                 Uint64 holes,
+                 NetworkAccumulator& accumulator) const;
+
+    /**
+     * Accumulator next of the position after a move of player from the
+     * one of current: the blobs of player added on empty cells (the
+     * destination), removed (the origin of a jump) and captured.
+     */
+    void update(const NetworkAccumulator& current,
+                NetworkAccumulator& next,
+                Uint16 player,
+                Uint64 added,
+                Uint64 removed,
+                Uint64 captured) const;
+
+    //! score of the position of accumulator for player (to move), in
+    //! points
+    Sint32 evaluate(const NetworkAccumulator& accumulator,
+                    Uint16 player) const;
+
+    //! score of the position of mine (the player to move) and theirs,
+    //! without accumulator
+    Sint32 evaluate(Uint64 mine, Uint64 theirs, Uint64 holes) const;
+
+    //! update and evaluate without SIMD
+    void updateScalar(const NetworkAccumulator& current,
+                      NetworkAccumulator& next,
+                      Uint16 player,
+                      Uint64 added,
+                      Uint64 removed,
+                      Uint64 captured) const;
+    Sint32 evaluateScalar(const NetworkAccumulator& accumulator,
+                          Uint16 player) const;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "patterns.h"
+
+#include <fstream>
+
+#include "rulescore.h"
+
+//! first cell (top left) of the windows not in a corner
+static const Uint8 windowCells[] = {
+    1,  2,  3,  4,  8,  9,  10, 11, 12, 13, 16, 17, 18, 19, 20, 21,
+    24, 25, 26, 27, 28, 29, 32, 33, 34, 35, 36, 37, 41, 42, 43, 44};
+
+//! first cell of the windows of the corners (0, 0), (0, 7), (7, 0), (7, 7)
+static const Uint8 cornerCells[] = {0, 5, 40, 45};
+
+//! bits of a column to the bits of a byte (row x to bit x)
+#define COLUMN_TO_BYTE 0x0102040810204080ULL
+
+/**
+ * Tables giving the codes of the patterns from their bits.
+ */
+struct patternTables {
+    //! base 3 number whose digits are the bits of a 9 bit number
+    Uint16 base3[512];
+    //! bits of a window turned so that the corner of cornerCells[i] comes
+    //! first: the columns are reversed for the corners of the last column,
+    //! the rows for the corners of the last row
+    Uint16 turn[4][512];
+
+    patternTables() {
+        for (Uint32 bits = 0; bits < 512; ++bits) {
+            Uint32 code = 0;
+            for (Sint32 b = 8; b >= 0; --b) {
+                code = code * 3 + ((bits >> b) & 1);
+            }
+            base3[bits] = code;
+
+            for (Uint32 corner = 0; corner < 4; ++corner) {
+                Uint32 turned = 0;
+                for (Uint32 row = 0; row < 3; ++row) {
+                    for (Uint32 column = 0; column < 3; ++column) {
+                        Uint32 r = corner & 2 ? 2 - row : row;
+                        Uint32 c = corner & 1 ? 2 - column : column;
+                        turned |= ((bits >> (r * 3 + c)) & 1)
+                                  << (row * 3 + column);
+                    }
+                }
+                turn[corner][bits] = turned;
+            }
+        }
+    }
+};
+
+static const patternTables tables;
+
+//! the 9 bits of the 3x3 window of board whose top left cell is cell,
+//! row by row
+static inline Uint32 windowBits(Uint64 board, Uint32 cell) {
+    Uint64 b = board >> cell;
+    return (b & 0x7) | ((b >> 5) & 0x38) | ((b >> 10) & 0x1c0);
+}
+
+//! the 8 bits of each edge of board: first and last rows, first and last
+//! columns
+static inline void edgeBits(Uint64 board, Uint32 bits[4]) {
+    bits[0] = board & 0xff;
+    bits[1] = board >> 56;
+    bits[2] = ((board & COLUMN_FIRST) * COLUMN_TO_BYTE) >> 56;
+    bits[3] = (((board >> 7) & COLUMN_FIRST) * COLUMN_TO_BYTE) >> 56;
+}
+
+//! index of a pattern if flag is 1, PATTERN_NONE if it is 0
+static inline Uint32 counted(Uint32 index, Uint32 flag) {
+    return index * flag;
+}
+
+PatternEvaluator::PatternEvaluator() : _weights(PATTERN_WEIGHTS, 0) {
+    _weights[PATTERN_MATERIAL] = PATTERN_SCALE;
+}
+
+void PatternEvaluator::features(Uint64 mine,
+                                Uint64 theirs,
+                                Uint64 holes,
+                                Uint32 indices[PATTERN_FEATURES]) {
+    // windows are counted when their centre has no hole around it
+    Uint64 clear = ~grow(holes);
+    Uint32 n = 0;
+
+    for (Uint8 cell : windowCells) {
+        Uint32 code = tables.base3[windowBits(mine, cell)] +
+                      2 * tables.base3[windowBits(theirs, cell)];
+        indices[n++] =
+            counted(PATTERN_WINDOWS + code, (clear >> (cell + 9)) & 1);
+    }
+
+    for (Uint32 corner = 0; corner < 4; ++corner) {
+        Uint32 cell = cornerCells[corner];
+        const Uint16* turn = tables.turn[corner];
+        Uint32 code = tables.base3[turn[windowBits(mine, cell)]] +
+                      2 * tables.base3[turn[windowBits(theirs, cell)]];
+        indices[n++] =
+            counted(PATTERN_CORNERS + code, (clear >> (cell + 9)) & 1);
+    }
+
+    Uint32 mineEdges[4], theirEdges[4], holeEdges[4];
+    edgeBits(mine, mineEdges);
+    edgeBits(theirs, theirEdges);
+    edgeBits(holes, holeEdges);
+    for (Uint32 edge = 0; edge < 4; ++edge) {
+        Uint32 code = tables.base3[mineEdges[edge]] +
+                      2 * tables.base3[theirEdges[edge]];
+        indices[n++] = counted(PATTERN_EDGES + code, holeEdges[edge] == 0);
+    }
+
+    Uint64 empty = ~(mine | theirs | holes);
+    indices[n++] =
+        PATTERN_THREATS + cellCount(grow(reach(mine) & empty) & theirs);
+    indices[n++] = PATTERN_THREATS + PATTERN_THREAT_CODES +
+                   cellCount(grow(reach(theirs) & empty) & mine);
+}
+
+Sint32 PatternEvaluator::evaluate(Uint64 mine,
+                                  Uint64 theirs,
+                                  Uint64 holes) const {
+    Uint32 indices[PATTERN_FEATURES];
+    features(mine, theirs, holes, indices);
+
+    const Sint16* w = _weights.data();
+    Sint32 score = ((Sint32)cellCount(mine) - (Sint32)cellCount(theirs)) *
+                   w[PATTERN_MATERIAL];
+    for (Uint32 i = 0; i < PATTERN_FEATURES; ++i) {
+        score += w[indices[i]];
+    }
+    return score;
+}
+
+bool PatternEvaluator::load(const string& filename) {
+    ifstream infile(filename.c_str(), ios::in | ios::binary);
+    PatternHeader header;
+    if (!infile.read((char*)&header, sizeof(header)) ||
+        header.magic != PATTERN_MAGIC || header.version != PATTERN_VERSION ||
+        header.count != PATTERN_WEIGHTS) {
+        return false;
+    }
+    vector<Sint16> weights(PATTERN_WEIGHTS);
+    if (!infile.read((char*)weights.data(),
+                     PATTERN_WEIGHTS * sizeof(Sint16))) {
+        return false;
+    }
+    weights[PATTERN_NONE] = 0;
+    _weights = weights;
+    return true;
+}
+
+bool PatternEvaluator::write(const string& filename) const {
+    ofstream outfile(filename.c_str(), ios::out | ios::binary);
+    if (!outfile) {
+        return false;
+    }
+    PatternHeader header = {PATTERN_MAGIC, PATTERN_VERSION, PATTERN_WEIGHTS};
+    outfile.write((const char*)&header, sizeof(header));
+    outfile.write((const char*)_weights.data(),
+                  PATTERN_WEIGHTS * sizeof(Sint16));
+    return (bool)outfile;
+}
@@ -0,0 +1,107 @@
+#ifndef __PATTERNS_H
+#define __PATTERNS_H
+
+#include "SDL_stdinc.h"
+#include "common.h"
+
+//! file of the weights loaded by default
+#define PATTERN_WEIGHTS_FILE "data/eval/patterns.weights"
+
+//! first bytes of a weight file ("blobeval" read as a little-endian word)
+#define PATTERN_MAGIC 0x6c617665626f6c62ULL
+//! version of the format, changes with the file layout or the features
+#define PATTERN_VERSION 1
+
+//! points of the evaluation per blob of material with the default weights,
+//! the weights are in points
+#define PATTERN_SCALE 16
+
+//! codes of the patterns: 3 ^ cells (each cell empty, mine or theirs)
+#define PATTERN_WINDOW_CODES 19683
+#define PATTERN_EDGE_CODES 6561
+//! counts of threatened blobs, 0 to 64
+#define PATTERN_THREAT_CODES 65
+
+/*
+ * Index of the first weight of each feature. The weight of PATTERN_NONE
+ * is always 0: the patterns which are not counted (those with holes) use
+ * it, so that every position has the same number of features.
+ */
+#define PATTERN_NONE 0
+//! per blob of material of the player to move (minus the other player)
+#define PATTERN_MATERIAL 1
+//! by number of blobs of the other player next to an empty cell the
+//! player to move reaches, then the same for the other player
+#define PATTERN_THREATS 2
+//! 3x3 windows not in a corner, by code (see PatternEvaluator)
+#define PATTERN_WINDOWS (PATTERN_THREATS + 2 * PATTERN_THREAT_CODES)
+//! 3x3 windows of the corners, turned so that the corner comes first
+#define PATTERN_CORNERS (PATTERN_WINDOWS + PATTERN_WINDOW_CODES)
+//! lines of the four edges
+#define PATTERN_EDGES (PATTERN_CORNERS + PATTERN_WINDOW_CODES)
+//! number of weights
+#define PATTERN_WEIGHTS (PATTERN_EDGES + PATTERN_EDGE_CODES)
+
+//! features of a position besides material: 32 windows, 4 corners, 4
+//! edges and 2 threat counts
+#define PATTERN_FEATURES 42
+
+//! start of a weight file, followed by count Sint16 weights
+struct PatternHeader {
+    Uint64 magic;
+    Uint32 version;
+    //! number of weights (PATTERN_WEIGHTS)
+    Uint32 count;
+};
+
+/**
+ * Evaluation of a position by pattern tables, an alternative to the blob
+ * difference (see EngineConfig::evaluation).
+ * The score, for the player to move, is a weight per blob of material
+ * plus the weight of each feature of the position:
+ * - the 3x3 windows of the board, 32 of them centred on a cell next to an
+ *   edge or inside and the 4 of the corners in their own table,
+ * - the lines of the four edges,
+ * - how many blobs each player may capture at once.
+ * A window or a line is indexed by the base 3 code of its cells (0 empty,
+ * 1 mine, 2 theirs), computed from the bitboards with a table: a lookup is
+ * a few shifts and loads, without branch. Windows and lines with holes are
+ * not counted.
+ * The weights are loaded from a file (see PatternEvaluator::load), the
+ * default ones only count material.
+ */
+class PatternEvaluator {
+   private:
+    vector<Sint16> _weights;
+
+   public:
+    //! the default weights
+    PatternEvaluator();
+
+    /**
+     * Load the weights of filename, returns false (and keeps the weights)
+     * if it cannot be read or is not a weight file of this version.
+     */
+    bool load(const string& filename);
+
+    //! write the weights to filename, returns false if it cannot be written
+    bool write(const string& filename) const;
+
+    //! the weights, by index of feature
+    const vector<Sint16>& weights() const { return _weights; }
+    void setWeights(const vector<Sint16>& weights) { _weights = weights; }
+
+    /**
+     * Index of the weight of each feature of the position of mine (the
+     * player to move) and theirs (PATTERN_NONE for those not counted).
+     */
+    static void features(Uint64 mine,
+                         Uint64 theirs,
+                         Uint64 holes,
+                         Uint32 indices[PATTERN_FEATURES]);
+
+    //! score of the position for the player to move (mine), in points
+    Sint32 evaluate(Uint64 mine, Uint64 theirs, Uint64 holes) const;
+};
+
+#endif
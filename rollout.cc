@@ -0,0 +1,234 @@
+#include "rollout.h"
+
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ROLLOUT_AVX2
+#endif
+
+//! xorshift64, the multiplication of xorshift64* has no AVX2 instruction
+static inline Uint64 nextRandom(Uint64& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+//! a cell of a non empty mask: the first one from a random cell on (the
+//! top 6 bits of random), going round the board
+static inline Uint64 pickCell(Uint64 mask, Uint64 random) {
+    Uint32 shift = random >> 58;
+    Uint64 rotated = (mask >> shift) | (mask << ((64 - shift) & 63));
+    Uint64 cell = rotated & (0 - rotated);
+    return (cell << shift) | (cell >> ((64 - shift) & 63));
+}
+
+//! 2 per capture and 1 for a copy, of a move of mine to cell
+static inline Uint64 captureScore(Uint64 mine, Uint64 theirs, Uint64 cell) {
+    Uint64 near = grow(cell);
+    return ((Uint64)cellCount(near & theirs) << 1) + ((near & mine) != 0);
+}
+
+void RolloutBatch::seed(Uint64 seed) {
+    for (Uint32 i = 0; i < ROLLOUT_LANES; ++i) {
+        seed += 0x9e3779b97f4a7c15ULL;
+        random[i] = seed != 0 ? seed : 1;
+    }
+}
+
+Uint64 playRolloutsScalar(RolloutBatch& batch, Uint64 holes, Uint32 plies) {
+    Uint64 moves = 0;
+    for (Uint32 i = 0; i < ROLLOUT_LANES; ++i) {
+        Uint64 mine = batch.mine[i];
+        Uint64 theirs = batch.theirs[i];
+        Uint64& random = batch.random[i];
+        // mine and theirs are swapped after each ply
+        bool swapped = false;
+        for (Uint32 ply = 0; ply < plies; ++ply) {
+            // drawn even when the lane does not play, as by the AVX2 version
+            Uint64 first = nextRandom(random);
+            Uint64 second = nextRandom(random);
+
+            Uint64 empty = ~(mine | theirs | holes);
+            Uint64 targets = reach(mine) & empty;
+            if (mine == 0 || theirs == 0 ||
+                (targets == 0 && (reach(theirs) & empty) == 0)) {
+                continue;
+            }
+            if (targets != 0) {
+                ++moves;
+                Uint64 to = pickCell(targets, first);
+                Uint64 other = pickCell(targets, second);
+                if (captureScore(mine, theirs, other) >
+                    captureScore(mine, theirs, to)) {
+                    to = other;
+                }
+                Uint64 near = grow(to);
+                Uint64 from = 0;
+                if ((near & mine) == 0) {
+                    Uint64 origins = reach(to) & ~near & mine;
+                    from = origins & (0 - origins);
+                }
+                Uint64 captured = theirs & near;
+                mine = (mine & ~from) | captured | to;
+                theirs &= ~captured;
+            }
+            std::swap(mine, theirs);
+            swapped = !swapped;
+        }
+        batch.mine[i] = swapped ? theirs : mine;
+        batch.theirs[i] = swapped ? mine : theirs;
+        batch.result[i] = (Sint64)cellCount(batch.mine[i]) -
+                          (Sint64)cellCount(batch.theirs[i]);
+    }
+    return moves;
+}
+
+#ifdef ROLLOUT_AVX2
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i nextRandom(__m256i& state) {
+    state = _mm256_xor_si256(state, _mm256_slli_epi64(state, 13));
+    state = _mm256_xor_si256(state, _mm256_srli_epi64(state, 7));
+    state = _mm256_xor_si256(state, _mm256_slli_epi64(state, 17));
+    return state;
+}
+
+//! all ones in the lanes where x is 0
+AVX2 static inline __m256i isZero(__m256i x) {
+    return _mm256_cmpeq_epi64(x, _mm256_setzero_si256());
+}
+
+AVX2 static inline __m256i lowestCell(__m256i x) {
+    return _mm256_and_si256(x, _mm256_sub_epi64(_mm256_setzero_si256(), x));
+}
+
+//! cellCount of each lane (nibble table, AVX2 has no 64-bit popcount)
+AVX2 static inline __m256i cellCount(__m256i x) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2,
+                                           3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2,
+                                           2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i low = _mm256_and_si256(x, nibble);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, low),
+                                    _mm256_shuffle_epi8(table, high));
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+}
+
+AVX2 static inline __m256i grow(__m256i x) {
+    __m256i line = _mm256_or_si256(
+        x,
+        _mm256_or_si256(
+            _mm256_andnot_si256(_mm256_set1_epi64x(COLUMN_FIRST),
+                                _mm256_slli_epi64(x, 1)),
+            _mm256_andnot_si256(_mm256_set1_epi64x(COLUMN_LAST),
+                                _mm256_srli_epi64(x, 1))));
+    return _mm256_or_si256(line,
+                           _mm256_or_si256(_mm256_slli_epi64(line, 8),
+                                           _mm256_srli_epi64(line, 8)));
+}
+
+AVX2 static inline __m256i reach(__m256i x) { return grow(grow(x)); }
+
+AVX2 static inline __m256i pickCell(__m256i mask, __m256i random) {
+    __m256i shift = _mm256_srli_epi64(random, 58);
+    // shifts by 64 give 0, which is what a rotation by 0 needs
+    __m256i back = _mm256_sub_epi64(_mm256_set1_epi64x(64), shift);
+    __m256i rotated = _mm256_or_si256(_mm256_srlv_epi64(mask, shift),
+                                      _mm256_sllv_epi64(mask, back));
+    __m256i cell = lowestCell(rotated);
+    return _mm256_or_si256(_mm256_sllv_epi64(cell, shift),
+                           _mm256_srlv_epi64(cell, back));
+}
+
+AVX2 static inline __m256i captureScore(__m256i mine,
+                                        __m256i theirs,
+                                        __m256i cell) {
+    __m256i near = grow(cell);
+    __m256i copy = _mm256_andnot_si256(isZero(_mm256_and_si256(near, mine)),
+                                       _mm256_set1_epi64x(1));
+    return _mm256_add_epi64(
+        _mm256_slli_epi64(cellCount(_mm256_and_si256(near, theirs)), 1),
+        copy);
+}
+
+//! playRolloutsScalar on four lanes at once, the branches of a lane
+//! being masks
+AVX2 static Uint64 playRolloutsAvx2(RolloutBatch& batch,
+                                    Uint64 holes,
+                                    Uint32 plies) {
+    const __m256i wall = _mm256_set1_epi64x(holes);
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    Uint64 moves = 0;
+    for (Uint32 i = 0; i < ROLLOUT_LANES; i += 4) {
+        __m256i mine = _mm256_load_si256((const __m256i*)&batch.mine[i]);
+        __m256i theirs = _mm256_load_si256((const __m256i*)&batch.theirs[i]);
+        __m256i random = _mm256_load_si256((const __m256i*)&batch.random[i]);
+        __m256i swapped = _mm256_setzero_si256();
+        for (Uint32 ply = 0; ply < plies; ++ply) {
+            __m256i first = nextRandom(random);
+            __m256i second = nextRandom(random);
+
+            __m256i empty = _mm256_xor_si256(
+                _mm256_or_si256(_mm256_or_si256(mine, theirs), wall), ones);
+            __m256i targets = _mm256_and_si256(reach(mine), empty);
+            __m256i playing = _mm256_andnot_si256(
+                _mm256_or_si256(isZero(mine), isZero(theirs)), ones);
+            __m256i moving = _mm256_andnot_si256(isZero(targets), playing);
+            __m256i passing = _mm256_andnot_si256(
+                isZero(_mm256_and_si256(reach(theirs), empty)),
+                _mm256_and_si256(isZero(targets), playing));
+            moves += __builtin_popcount(
+                _mm256_movemask_pd(_mm256_castsi256_pd(moving)));
+
+            __m256i to = pickCell(targets, first);
+            __m256i other = pickCell(targets, second);
+            to = _mm256_blendv_epi8(
+                to,
+                other,
+                _mm256_cmpgt_epi64(captureScore(mine, theirs, other),
+                                   captureScore(mine, theirs, to)));
+            __m256i near = grow(to);
+            __m256i from = _mm256_and_si256(
+                isZero(_mm256_and_si256(near, mine)),
+                lowestCell(_mm256_and_si256(
+                    _mm256_andnot_si256(near, reach(to)), mine)));
+            __m256i captured = _mm256_and_si256(theirs, near);
+            __m256i played = _mm256_or_si256(
+                _mm256_andnot_si256(from, mine), _mm256_or_si256(captured, to));
+            mine = _mm256_blendv_epi8(mine, played, moving);
+            theirs = _mm256_blendv_epi8(
+                theirs, _mm256_andnot_si256(captured, theirs), moving);
+
+            __m256i turn = _mm256_or_si256(moving, passing);
+            __m256i next = _mm256_blendv_epi8(mine, theirs, turn);
+            theirs = _mm256_blendv_epi8(theirs, mine, turn);
+            mine = next;
+            swapped = _mm256_xor_si256(swapped, turn);
+        }
+        __m256i first = _mm256_blendv_epi8(mine, theirs, swapped);
+        __m256i second = _mm256_blendv_epi8(theirs, mine, swapped);
+        _mm256_store_si256((__m256i*)&batch.mine[i], first);
+        _mm256_store_si256((__m256i*)&batch.theirs[i], second);
+        _mm256_store_si256((__m256i*)&batch.random[i], random);
+        _mm256_store_si256(
+            (__m256i*)&batch.result[i],
+            _mm256_sub_epi64(cellCount(first), cellCount(second)));
+    }
+    return moves;
+}
+
+#endif
+
+Uint64 playRollouts(RolloutBatch& batch, Uint64 holes, Uint32 plies) {
+#ifdef ROLLOUT_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) {
+        return playRolloutsAvx2(batch, holes, plies);
+    }
+#endif
+    return playRolloutsScalar(batch, holes, plies);
+}
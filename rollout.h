@@ -0,0 +1,43 @@
+#ifndef __ROLLOUT_H
+#define __ROLLOUT_H
+
+#include "SDL_stdinc.h"
+#include "rulescore.h"
+
+//! games played at once by a rollout batch (two AVX2 registers of four)
+#define ROLLOUT_LANES 8
+
+/**
+ * Independent games played at once by random rollouts, one per lane.
+ * A lane holds the blobs of the player to move when the rollout starts
+ * (mine), those of the other player and its own random generator; the
+ * holes are the same for all the lanes.
+ */
+struct RolloutBatch {
+    alignas(32) Uint64 mine[ROLLOUT_LANES];
+    alignas(32) Uint64 theirs[ROLLOUT_LANES];
+    //! xorshift64 states, never 0
+    alignas(32) Uint64 random[ROLLOUT_LANES];
+    //! result of the last rollout of each lane: blobs of mine minus blobs
+    //! of theirs, once played
+    alignas(32) Sint64 result[ROLLOUT_LANES];
+
+    //! random generators of all the lanes drawn from seed
+    void seed(Uint64 seed);
+};
+
+/**
+ * Play plies plies of random moves in every lane (less in a lane whose
+ * game ends) and set the results, returns the number of moves played.
+ * Each ply draws two empty cells the player to move reaches and plays to
+ * the one which captures more, copying if it can. A player who cannot
+ * move passes.
+ * Runs on AVX2 when the processor has it, on the scalar version otherwise:
+ * both play the same moves.
+ */
+Uint64 playRollouts(RolloutBatch& batch, Uint64 holes, Uint32 plies);
+
+//! playRollouts one lane after the other, without SIMD
+Uint64 playRolloutsScalar(RolloutBatch& batch, Uint64 holes, Uint32 plies);
+
+#endif
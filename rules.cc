@@ -53,6 +53,9 @@ bool player::is_computer() { return (player_type == 1); }
 
 rules::rules(Uint16 type, board* b, Uint32 local_player_id) {
     gametype = type;
+    headless = false;
+    engine_config = &game->engine_config;
+    compute_time_IA = game->compute_time_IA;
 
     if (type == GAME4PMATCH)
         number_of_players = 4;
@@ -72,22 +75,7 @@ rules::rules(Uint16 type, board* b, Uint32 local_player_id) {
     // we start, the game is not finished yet
     finished = false;
 
-    // initially no one has blobs...
-    for (Uint8 i = 0; i < 8; i++)
-        for (Uint8 j = 0; j < 8; j++) blobs.set(i, j, -1);
-
-    //...only one blob in each corner
-    if (number_of_players == 2) {
-        blobs.set(0, 0, 0);
-        blobs.set(7, 0, 0);
-        blobs.set(0, 7, 1);
-        blobs.set(7, 7, 1);
-    } else {
-        blobs.set(0, 0, 0);
-        blobs.set(7, 0, 1);
-        blobs.set(0, 7, 2);
-        blobs.set(7, 7, 3);
-    }
+    init_blobs();
     // put the blobs in place on the board
     game->bwboard->init(number_of_players);
 
@@ -139,6 +127,54 @@ rules::rules(Uint16 type, board* b, Uint32 local_player_id) {
     next_turn();
 }
 
+rules::rules(const bidiarray<bool>& map,
+             const EngineConfig& config,
+             int compute_time) {
+    gametype = GAME2PMATCH;
+    headless = true;
+    engine_config = &config;
+    compute_time_IA = compute_time;
+    number_of_players = 2;
+    turn_number = 0;
+    holes = map;
+
+    colors = new string[number_of_players];
+    colors[0] = "Red";
+    colors[1] = "Blue";
+
+    finished = false;
+    init_blobs();
+    players.push_back(new player(0, 1));
+    players.push_back(new player(1, 1));
+}
+
+void rules::init_blobs() {
+    // initially no one has blobs...
+    for (Uint8 i = 0; i < 8; i++)
+        for (Uint8 j = 0; j < 8; j++) blobs.set(i, j, -1);
+
+    //...only one blob in each corner
+    if (number_of_players == 2) {
+        blobs.set(0, 0, 0);
+        blobs.set(7, 0, 0);
+        blobs.set(0, 7, 1);
+        blobs.set(7, 7, 1);
+    } else {
+        blobs.set(0, 0, 0);
+        blobs.set(7, 0, 1);
+        blobs.set(0, 7, 2);
+        blobs.set(7, 7, 3);
+    }
+
+    // same position for the rules core, kept up to date by do_move
+    state.clear(number_of_players);
+    for (Uint8 i = 0; i < 8; i++)
+        for (Uint8 j = 0; j < 8; j++) {
+            state.set(i, j, blobs.get(i, j));
+            if (holes.get(i, j)) state.holes |= cellMask(i, j);
+        }
+}
+
 rules::~rules() {
     for (vector<player*>::iterator it = players.begin(); it != players.end();
          it++) {
@@ -159,55 +195,14 @@ bool rules::authorize_selection(Uint8 x, Uint8 y) {
 }
 
 bool rules::valid_move() {
-    // first, check if the move is on the board
-    if ((ox < 0) || (ox > 8) || (nx < 0) || (nx > 8) || (oy < 0) || (oy > 8) ||
-        (ny < 0) || (ny > 8)) {
-#ifdef DEBUG
-        cout << "trying to move outside of the board, refusing move" << endl;
-        return false;
-#endif
-    }
-    // check source is not destination
-    if ((ox == nx) && (oy == ny)) {
-#ifdef DEBUG
-        cout << "moving on same spot, refusing move" << endl;
-        return false;
-#endif
-    }
-    // now, check we don't move on empty space
-    if (holes.get(nx, ny)) {
-#ifdef DEBUG
-        cout << "trying to move into a hole, refusing move" << endl;
-#endif
-        return false;
-    }
-    // check there is no one there
-    if (blobs.get(nx, ny) != -1) {
-#ifdef DEBUG
-        cout << "trying to move into someone, refusing move" << endl;
-#endif
-        return false;
-    }
-    // check if we are trying to move someone from the other side
-    if (blobs.get(ox, oy) != Sint32(CURRENT_PLAYER)) {
-#ifdef DEBUG
-        cout << "trying to move from a blob of the other side, refusing move"
-             << endl;
-#endif
-        return false;
-    }
-    // check distance and type of move
-    // we first compute the square of the distance
-    Uint32 d = (ox - nx) * (ox - nx);
-    Uint32 d2 = (oy - ny) * (oy - ny);
-    d = (d > d2) ? d : d2;
-    if (d <= 4) {
-        // move accepted
+    // bounds, owner of the blob, free destination and distance are checked
+    // by the rules core (shared with the server and the AI)
+    if (state.isLegal(CURRENT_PLAYER, movement(ox, oy, nx, ny)))
         return true;
-    }
-    // too far
 #ifdef DEBUG
-    cout << "trying to move too far, refusing move" << endl;
+    cout << "invalid move from (" << (Uint32)ox << "," << (Uint32)oy
+         << ") to (" << (Uint32)nx << "," << (Uint32)ny << "), refusing move"
+         << endl;
 #endif
     return false;
 }
@@ -247,171 +242,166 @@ void rules::do_move() {
             for (Uint8 j = 0; j < 8; j++)
                 if (blobs.get(i, j) == Sint32(CURRENT_PLAYER))
                     blobs.set(i, j, !CURRENT_PLAYER);
+        state.blobs[!CURRENT_PLAYER] |= state.blobs[CURRENT_PLAYER];
+        state.blobs[CURRENT_PLAYER] = 0;
     } else {
-        pthread_mutex_lock(&game->mutex);
-
-        // we don't need selection anymore
-        game->bwboard->unselect_tile(ox, oy);
-        // first check if we need to create a new blob or to move an old one
-        if (((ox - nx) * (ox - nx) <= 1) && ((oy - ny) * (oy - ny) <= 1)) {
-            // it's a copy
-            // notify local board of the copy
-            game->bwboard->create_blob(nx, ny, CURRENT_PLAYER);
-            // update our info
-            blobs.set(nx, ny, CURRENT_PLAYER);
-        } else {
-            // it's a move
-            // notify local board of the move
-            game->bwboard->move_blob(ox, oy, nx, ny);
-            // update rules info
-            blobs.set(ox, oy, -1);
-            blobs.set(nx, ny, CURRENT_PLAYER);
-        }
-        // now eventually change some neighbours colors
+        movement mv(ox, oy, nx, ny);
         Sint16 current_player = CURRENT_PLAYER;
+        Uint64 captured = state.apply(current_player, mv);
+
+        // without display, only our info is updated
+        if (!headless) {
+            pthread_mutex_lock(&game->mutex);
+            // we don't need selection anymore
+            game->bwboard->unselect_tile(ox, oy);
+            // notify local board of the copy or of the move
+            if (mv.distance() == 1)
+                game->bwboard->create_blob(nx, ny, current_player);
+            else
+                game->bwboard->move_blob(ox, oy, nx, ny);
+        }
+        // update our info
+        if (mv.distance() != 1) blobs.set(ox, oy, -1);
+        blobs.set(nx, ny, current_player);
+
+        // now change the colors of the captured neighbours
+        for (; captured; captured &= captured - 1) {
+            Uint8 cell = firstCell(captured);
+            if (!headless)
+                game->bwboard->change_blob_owner(
+                    cell / 8, cell % 8, current_player);
+            blobs.set(cell / 8, cell % 8, current_player);
+        }
 
-        for (Sint8 i = -1; i < 2; i++)
-            for (Sint8 j = -1; j < 2; j++) {
-                if (nx + i < 0) continue;
-                if (nx + i > 7) continue;
-                if (ny + j < 0) continue;
-                if (ny + j > 7) continue;
-                if ((blobs.get(nx + i, ny + j) != -1) &&
-                    (blobs.get(nx + i, ny + j) != current_player)) {
-                    game->bwboard->change_blob_owner(
-                        nx + i, ny + j, current_player);
-                    blobs.set(nx + i, ny + j, current_player);
-                }
-            }
-
-        pthread_mutex_unlock(&game->mutex);
+        if (!headless) pthread_mutex_unlock(&game->mutex);
     }
 
     // a player finished moving, go to next turn
     next_turn();
 }
 
+//! what the timer needs to stop the computer
+struct timer_data {
+    pid_t pid;
+    int seconds;
+};
+
 void* timer(void* d) {
+    timer_data* data = (timer_data*)d;
 #ifdef DEBUG
-    cout << "Timer start for " << game->compute_time_IA << "s" << endl;
+    cout << "Timer start for " << data->seconds << "s" << endl;
 #endif
-    sleep(game->compute_time_IA);
+    sleep(data->seconds);
 #ifdef DEBUG
-    cout << "Timer out. Now kill the IA (pid: " << (*((pid_t*)d)) << ")"
-         << endl;
+    cout << "Timer out. Now kill the IA (pid: " << data->pid << ")" << endl;
 #endif
-    kill(*((pid_t*)d), SIGTERM);
+    kill(data->pid, SIGTERM);
     return NULL;
 }
 
 void rules::compute_move() {
     shmem_init(true);
+    Uint64 spawn_start = shmem_clock();
 
     string cplayer("0");
     cplayer[0] = '0' + (CURRENT_PLAYER);
 
+    // ./launchStrategy blobs holes player followed by the engine options
+    vector<string> args;
+    args.push_back("./launchStrategy");
+    args.push_back(blobs.serialize());
+    args.push_back(holes.serialize());
+    args.push_back(cplayer);
+    vector<string> options = engineArguments(*engine_config);
+    args.insert(args.end(), options.begin(), options.end());
+
+    vector<char*> argv;
+    for (string& arg : args) {
+        argv.push_back((char*)arg.c_str());
+    }
+    argv.push_back(NULL);
+
 #ifdef DEBUG
-    printf("Now fork: %s %s %s %s\n",
-           "./launchStrategy",
-           blobs.serialize().c_str(),
-           holes.serialize().c_str(),
-           cplayer.c_str());
+    printf("Now fork:");
+    for (string& arg : args) {
+        printf(" %s", arg.c_str());
+    }
+    printf("\n");
 #endif
     int childPid = fork();
     if (childPid == 0)  // Child process
     {
-        execl("./launchStrategy",
-              "./launchStrategy",
-              blobs.serialize().c_str(),
-              holes.serialize().c_str(),
-              cplayer.c_str(),
-              (char*)NULL);
+        execv("./launchStrategy", argv.data());
     }
 
     // start timer
     pthread_t timerThread;
-    pthread_create(&timerThread, NULL, timer, (void*)&childPid);
+    timer_data data = {childPid, compute_time_IA};
+    pthread_create(&timerThread, NULL, timer, (void*)&data);
 
     int status;
     while (wait(&status) != childPid) /* empty */
         ;
     pthread_cancel(timerThread);
+    pthread_join(timerThread, NULL);
+    Uint64 collected = shmem_clock();
 
     movement m = shmem_get();
     ox = m.ox;
     oy = m.oy;
     nx = m.nx;
     ny = m.ny;
+    Uint64 read = shmem_clock();
 
 #ifdef DEBUG
     cout << "computer computed move from: " << (Uint32)ox << "," << (Uint32)oy
          << " to " << (Uint32)nx << "," << (Uint32)ny << endl;
 #endif
 
+    turn_timing timing;
+    timing.turn = turn_number;
+    timing.player = CURRENT_PLAYER;
+
     if (gametype == NETGAME) {
         game->bwnet->do_move(ox, oy, nx, ny);
     } else {
         do_move();
     }
+
+    if (headless) {
+        Uint64 applied = shmem_clock();
+        Uint64 search_start, search_end;
+        shmem_get_search_times(search_start, search_end);
+        // killed before starting or finishing its search
+        if (search_start == 0) search_start = collected;
+        if (search_end == 0) search_end = collected;
+        timing.spawn = (search_start - spawn_start) / 1000.0;
+        timing.search = (search_end - search_start) / 1000.0;
+        timing.exit = (collected - search_end) / 1000.0;
+        timing.read = (read - collected) / 1000.0;
+        timing.apply = (applied - read) / 1000.0;
+        timings.push_back(timing);
+    }
 }
 
 void rules::next_turn() {
     turn_number++;
 
-    // first, check if only one player is left
-    bool alive[number_of_players];
-    for (Uint16 i = 0; i < number_of_players; i++) alive[i] = false;
-    for (Uint8 x = 0; x < 8; x++)
-        for (Uint8 y = 0; y < 8; y++)
-            if (blobs.get(x, y) != -1) alive[blobs.get(x, y)] = true;
-
-    Uint16 num = 0;
-    for (Uint16 i = 0; i < number_of_players; i++)
-        if (alive[i]) num++;
-
-    bool not_finished = false;
-    bool can_move[number_of_players];
-
-    // #ifdef DEBUG
-    // 	cout<<"turn finished ; remaining players : "<<num<<endl;
-    // #endif
-
-    if (num != 1) {
-        // first, check if someone can move (iterate on all empty spaces)
-        for (Uint16 i = 0; i < number_of_players; i++) can_move[i] = false;
-        for (Sint16 x = 0; x < 8; x++)
-            for (Sint16 y = 0; y < 8; y++) {
-                // if a hole we can't move in it, continue
-                if (holes.get(x, y)) continue;
-                // same if already occupied
-                if (blobs.get(x, y) != -1) continue;
-                // now this space is empty, check if someone can enter it
-                // loop on all neighbours
-                for (Sint16 i = -2; i <= 2; i++)
-                    for (Sint16 j = -2; j <= 2; j++) {
-                        if ((x + i < 0) || (y + j < 0) || (x + i > 7) ||
-                            (y + j > 7))
-                            continue;
-                        if (blobs.get(x + i, y + j) != -1)
-                            can_move[blobs.get(x + i, y + j)] = true;
-                    }
-            }
-
-        // now if no one can play any more, game is finished
-        for (Uint16 i = 0; i < number_of_players; i++)
-            not_finished = not_finished || can_move[i];
-    }
+    // players who can move (one bit per player): the cells reached by
+    // their blobs, intersected with the empty cells
+    Uint16 movable = state.movablePlayers();
 
-    if ((!not_finished) || (num == 1)) {
+    // finished if only one player is left or no one can play any more
+    if (state.gameOver(movable)) {
         end();
     } else {
         // ok we can continue playing
-        // loop until a player can play
-        while (!can_move[CURRENT_PLAYER]) {
-            turn_number++;
-        }
+        // skip the players who cannot play
+        turn_number += state.turnsToSkip(CURRENT_PLAYER, movable);
 
         // let this player play
+        // (a headless game is played by calling compute_move in a loop)
+        if (headless) return;
 
         game->set_main_label(colors[CURRENT_PLAYER] + " player's turn");
         if (players[CURRENT_PLAYER]->is_computer()) {
@@ -423,29 +413,15 @@ void rules::next_turn() {
 }
 
 void rules::set_scores() {
-    Uint32 scores[4];
-    scores[0] = 0;
-    scores[1] = 0;
-    scores[2] = 0;
-    scores[3] = 0;
-    for (Uint8 i = 0; i < 8; i++)
-        for (Uint8 j = 0; j < 8; j++)
-            if (blobs.get(i, j) != -1) scores[blobs.get(i, j)]++;
-    game->set_scores(scores[0], scores[1]);
+    game->set_scores(state.score(0), state.score(1));
     return;
 }
 
 void rules::end() {
     // someone won
     // compute who
-    Uint32 scores[4];
-    scores[0] = 0;
-    scores[1] = 0;
-    scores[2] = 0;
-    scores[3] = 0;
-    for (Uint8 i = 0; i < 8; i++)
-        for (Uint8 j = 0; j < 8; j++)
-            if (blobs.get(i, j) != -1) scores[blobs.get(i, j)]++;
+    for (Uint16 i = 0; i < 4; i++)
+        scores[i] = (i < number_of_players) ? state.score(i) : 0;
 
     Uint16 winner = 0;
     Uint32 max = 0;
@@ -461,6 +437,11 @@ void rules::end() {
         if (max == scores[i]) cnt++;
     }
 
+    if (headless) {
+        finished = true;
+        return;
+    }
+
     // forward the info to the interfaces
     if (cnt == 1) {
         // someone wins
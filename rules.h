@@ -20,7 +20,26 @@ class Timer;
 
 #define CURRENT_PLAYER (turn_number % number_of_players)
 
+#include "engine.h"
 #include "move.h"
+#include "rulescore.h"
+
+/**time spent by each step of a computer turn, in ms*/
+struct turn_timing {
+    //! turn number and player who played
+    Uint32 turn;
+    Uint16 player;
+    //! fork and exec of launchStrategy until its search starts
+    double spawn;
+    //! search of launchStrategy
+    double search;
+    //! end of the search until launchStrategy is collected
+    double exit;
+    //! reading the move from the shared memory
+    double read;
+    //! playing the move (and finding who plays next)
+    double apply;
+};
 
 /**player class
  * all different type of players (human, ia, networked)*/
@@ -59,12 +78,18 @@ class rules {
     //! go to next turn (also check if game is not finished)
     void next_turn();
 
+    //! put one blob in each corner
+    void init_blobs();
+
     //! end the game (someone won)
     void end();
     //
     //! checks if chosen move is valid
     bool valid_move();
 
+    //! blobs and holes for the rules core (same as blobs and holes)
+    boardState state;
+
    public:
     //! is the game finished ?
     bool finished;
@@ -83,8 +108,24 @@ class rules {
     //! current turn (number of turns elapsed since game beginning)
     Uint32 turn_number;
 
+    //! no display: computer players only, compute_move is called in a loop
+    //! until the game is finished (see blobwar --headless)
+    bool headless;
+    //! settings of the computer players
+    const EngineConfig* engine_config;
+    //! seconds given to the computer players
+    int compute_time_IA;
+    //! steps of each computer turn (headless games only)
+    vector<turn_timing> timings;
+    //! blobs of each player when the game finished
+    Uint32 scores[4];
+
     //! start a new game
     rules(Uint16 type, board* b, Uint32 local_player_id);
+    //! start a headless game between two computers
+    rules(const bidiarray<bool>& map,
+          const EngineConfig& config,
+          int compute_time);
     ~rules();
     //! ask the rules whether we have right to select a blob
     bool authorize_selection(Uint8 x, Uint8 y);
@@ -0,0 +1,187 @@
+#ifndef __RULESCORE_H
+#define __RULESCORE_H
+
+#include "SDL_stdinc.h"
+#include "move.h"
+
+/**
+ * Rules of blobwar on bitboards, shared by the client (rules), the server
+ * (server/rules) and the engine (Strategy).
+ * Cell (x, y) of the board (x being the line of the map files, as in
+ * bidiarray) is bit x * 8 + y of a mask.
+ * Header only and without dependency on the rest of the client, so that
+ * the server can include it.
+ */
+
+//! maximal number of players of a game
+#define MAX_PLAYERS 4
+
+//! cells of the first column (y == 0) and of the last one (y == 7)
+#define COLUMN_FIRST 0x0101010101010101ULL
+#define COLUMN_LAST 0x8080808080808080ULL
+
+//! mask of cell (x, y)
+inline Uint64 cellMask(Uint8 x, Uint8 y) { return 1ULL << (x * 8 + y); }
+
+//! number of cells of a mask
+inline Uint32 cellCount(Uint64 mask) { return __builtin_popcountll(mask); }
+
+//! index (x * 8 + y) of the first cell of a non empty mask
+inline Uint8 firstCell(Uint64 mask) { return __builtin_ctzll(mask); }
+
+//! cells at distance at most one of the cells of mask (mask included)
+inline Uint64 grow(Uint64 mask) {
+    Uint64 line =
+        mask | ((mask << 1) & ~COLUMN_FIRST) | ((mask >> 1) & ~COLUMN_LAST);
+    return line | (line << 8) | (line >> 8);
+}
+
+//! cells a blob of mask can copy or jump to, if they are empty
+inline Uint64 reach(Uint64 mask) { return grow(grow(mask)); }
+
+/**
+ * Blobs and holes of a game.
+ */
+struct boardState {
+    //! blobs of each player
+    Uint64 blobs[MAX_PLAYERS];
+    //! cells no blob can enter
+    Uint64 holes;
+    //! number of players (2 or 4)
+    Uint16 players;
+
+    //! an empty board without holes
+    void clear(Uint16 numberOfPlayers = 2) {
+        for (Uint16 p = 0; p < MAX_PLAYERS; ++p) {
+            blobs[p] = 0;
+        }
+        holes = 0;
+        players = numberOfPlayers;
+    }
+
+    //! owner of the blob in (x, y), -1 if none
+    Sint16 get(Uint8 x, Uint8 y) const {
+        Uint64 cell = cellMask(x, y);
+        for (Uint16 p = 0; p < players; ++p) {
+            if (blobs[p] & cell) {
+                return p;
+            }
+        }
+        return -1;
+    }
+
+    //! put a blob of player in (x, y) (-1 empties the cell)
+    void set(Uint8 x, Uint8 y, Sint16 player) {
+        Uint64 cell = cellMask(x, y);
+        for (Uint16 p = 0; p < players; ++p) {
+            blobs[p] &= ~cell;
+        }
+        if (player >= 0) {
+            blobs[player] |= cell;
+        }
+    }
+
+    //! is (x, y) a hole ?
+    bool isHole(Uint8 x, Uint8 y) const { return holes & cellMask(x, y); }
+
+    //! cells holding a blob
+    Uint64 occupied() const {
+        Uint64 all = 0;
+        for (Uint16 p = 0; p < players; ++p) {
+            all |= blobs[p];
+        }
+        return all;
+    }
+
+    //! cells a blob may enter
+    Uint64 empty() const { return ~(occupied() | holes); }
+
+    //! blobs of the other players
+    Uint64 opponents(Uint16 player) const {
+        return occupied() & ~blobs[player];
+    }
+
+    //! number of blobs of player
+    Uint32 score(Uint16 player) const { return cellCount(blobs[player]); }
+
+    //! may player play mv ?
+    bool isLegal(Uint16 player, const movement& mv) const {
+        if (mv.ox > 7 || mv.oy > 7 || mv.nx > 7 || mv.ny > 7) {
+            return false;
+        }
+        Uint8 d = mv.distance();
+        return d >= 1 && d <= 2 &&
+               (blobs[player] & cellMask(mv.ox, mv.oy)) &&
+               (empty() & cellMask(mv.nx, mv.ny));
+    }
+
+    /**
+     * Play a legal move of player: a copy for a distance of one, a jump
+     * otherwise, then the blobs around the destination change sides.
+     * Returns the captured blobs.
+     */
+    Uint64 apply(Uint16 player, const movement& mv) {
+        Uint64 destination = cellMask(mv.nx, mv.ny);
+        if (mv.distance() > 1) {
+            blobs[player] &= ~cellMask(mv.ox, mv.oy);
+        }
+        blobs[player] |= destination;
+
+        Uint64 around = grow(destination);
+        Uint64 captured = 0;
+        for (Uint16 p = 0; p < players; ++p) {
+            if (p != player) {
+                captured |= blobs[p] & around;
+                blobs[p] &= ~around;
+            }
+        }
+        blobs[player] |= captured;
+        return captured;
+    }
+
+    //! has player at least one legal move ?
+    bool canMove(Uint16 player) const {
+        return reach(blobs[player]) & empty();
+    }
+
+    //! players having blobs (bit p for player p)
+    Uint16 alivePlayers() const {
+        Uint16 alive = 0;
+        for (Uint16 p = 0; p < players; ++p) {
+            alive |= (blobs[p] != 0) << p;
+        }
+        return alive;
+    }
+
+    //! players having at least one legal move (bit p for player p): the
+    //! cells each player reaches, intersected with the empty cells
+    Uint16 movablePlayers() const {
+        Uint64 free = empty();
+        Uint16 movable = 0;
+        for (Uint16 p = 0; p < players; ++p) {
+            movable |= ((reach(blobs[p]) & free) != 0) << p;
+        }
+        return movable;
+    }
+
+    //! the game is over when at most one player has blobs or no one can
+    //! move
+    bool gameOver() const { return gameOver(movablePlayers()); }
+
+    //! same, knowing the players who can move
+    bool gameOver(Uint16 movable) const {
+        return movable == 0 || cellCount(alivePlayers()) <= 1;
+    }
+
+    /**
+     * Number of turns to skip, starting from player's turn, to reach a
+     * player who can move (0 if player can), movable must not be empty.
+     */
+    Uint16 turnsToSkip(Uint16 player, Uint16 movable) const {
+        // the players in turn order, starting from player
+        Uint32 order = (movable >> player) | (movable << (players - player));
+        return __builtin_ctz(order);
+    }
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef __SEARCHCONTEXT_H
+#define __SEARCHCONTEXT_H
+
+#include <atomic>
+#include <chrono>
+
+#include "SDL_stdinc.h"
+#include "book.h"
+#include "engine.h"
+#include "mcts.h"
+#include "move.h"
+#include "searchtrace.h"
+#include "transposition.h"
+
+class SearchPool;
+
+//! bound of the scores of the search
+#define SCORE_INFINITY 1000000
+
+//! score of a won game, minus the plies to the end of the game so that
+//! the winner goes for the shortest win and the loser for the longest loss
+#define SCORE_WIN 100000
+//! scores above this bound are wins, below its opposite losses
+#define SCORE_WIN_BOUND (SCORE_WIN - 1000)
+
+/**
+ * Parameters and results of one search.
+ * The strategy searching the root and the copies searching its moves in
+ * other threads share the context of their search, which is the only state
+ * they share: independent searches with their own contexts can run at the
+ * same time in one process.
+ * Only the strategy searching the root writes to it, except stop.
+ */
+struct SearchContext {
+    //! settings of the search, must outlive the context
+    const EngineConfig* config;
+    //! results shared with other searches, NULL if none
+    TranspositionTable* table;
+    //! trace of the search, NULL when not tracing
+    SearchTrace* trace;
+    //! opening book of the map, NULL if none
+    const OpeningBook* book;
+    //! tree of MCTS kept from the previous moves of the game, NULL to
+    //! start a new one
+    MonteCarloTree* tree;
+    //! evaluation of the leaves by patterns, NULL for material
+    const PatternEvaluator* evaluator;
+    //! evaluation of the leaves by a network, NULL for material
+    const NetworkEvaluator* network;
+    //! threads of alphabeta-parallel, kept from one search to the next,
+    //! NULL for threads of this search only
+    SearchPool* pool;
+    //! called with every new best move (may be NULL)
+    void (*saveBestMove)(movement&);
+    //! the search prints nothing to cout (its statistics, with _STAT):
+    //! for the programs running searches in several threads, or measuring
+    //! them
+    bool quiet = false;
+
+    //! set from any thread to stop the search: the searches return within
+    //! about a millisecond with the best move of the root moves searched
+    //! to the end, it stays set until its owner clears it
+    atomic<bool> stop{false};
+    //! the search stops by itself at deadline, if hasDeadline (set by
+    //! computeBestMove from the time budget)
+    chrono::steady_clock::time_point deadline;
+    bool hasDeadline = false;
+
+    //! depth of the current iteration, nodes at this depth are the root
+    Uint32 rootDepth = 0;
+
+    //! best move found so far, searched first by the next iteration
+    movement bestMove;
+    Sint32 bestScore = 0;
+    bool hasBestMove = false;
+
+    //! score of the last iteration of odd and even depth (scores swing
+    //! from one parity to the other), centres the windows of aspiration
+    //! and MTD(f); kept by the searches of the same position
+    Sint32 iterationScores[2];
+    bool hasIterationScore[2] = {false, false};
+
+    SearchContext(const EngineConfig& config = defaultEngineConfig,
+                  void (*saveBestMove)(movement&) = NULL,
+                  TranspositionTable* table = NULL,
+                  SearchTrace* trace = NULL,
+                  const OpeningBook* book = NULL,
+                  MonteCarloTree* tree = NULL,
+                  const PatternEvaluator* evaluator = NULL,
+                  const NetworkEvaluator* network = NULL,
+                  SearchPool* pool = NULL)
+        : config(&config),
+          table(table != NULL && table->enabled() ? table : NULL),
+          trace(trace),
+          book(book != NULL && book->enabled() ? book : NULL),
+          tree(tree),
+          evaluator(evaluator),
+          network(network),
+          pool(pool),
+          saveBestMove(saveBestMove) {}
+
+    //! the search must stop now, checked every few hundred nodes
+    bool stopped() const {
+        return stop.load(memory_order_relaxed) ||
+               (hasDeadline && chrono::steady_clock::now() >= deadline);
+    }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "searchpool.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "strategy.h"
+
+//! bind the calling thread to the worker-th core the process may use
+static void bindToCore(Uint32 worker) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return;
+    }
+    Uint32 n = worker % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed) && n-- == 0) {
+            cpu_set_t core;
+            CPU_ZERO(&core);
+            CPU_SET(cpu, &core);
+            pthread_setaffinity_np(pthread_self(), sizeof(core), &core);
+            return;
+        }
+    }
+#else
+    (void)worker;
+#endif
+}
+
+SearchPool::SearchPool(Uint32 size, bool affinity)
+    : _size(size != 0 ? size : max(thread::hardware_concurrency(), 1u)),
+      _affinity(affinity),
+      _strategies(_size) {}
+
+SearchPool::~SearchPool() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stop = true;
+    }
+    _start.notify_all();
+    for (thread& t : _threads) {
+        t.join();
+    }
+}
+
+void SearchPool::work(Uint32 worker) {
+    if (_affinity) {
+        bindToCore(worker);
+    }
+    Uint64 done = 0;
+    unique_lock<mutex> lock(_mutex);
+    for (;;) {
+        _start.wait(lock, [&] { return _stop || _run != done; });
+        if (_stop) {
+            return;
+        }
+        done = _run;
+        if (worker >= _workers) {
+            continue;
+        }
+        const function<void(Uint32)>& job = *_job;
+        lock.unlock();
+        job(worker);
+        lock.lock();
+        if (--_running == 0) {
+            _done.notify_one();
+        }
+    }
+}
+
+void SearchPool::run(Uint32 workers, const function<void(Uint32)>& job) {
+    workers = min(workers, _size);
+    if (workers == 0) {
+        return;
+    }
+    // started before the run is announced, they take part in it
+    while (_threads.size() < workers) {
+        _threads.push_back(
+            thread(&SearchPool::work, this, (Uint32)_threads.size()));
+    }
+
+    unique_lock<mutex> lock(_mutex);
+    _job = &job;
+    _workers = workers;
+    _running = workers;
+    ++_run;
+    _start.notify_all();
+    _done.wait(lock, [this] { return _running == 0; });
+    _job = NULL;
+}
+
+Strategy& SearchPool::strategy(Uint32 worker, const Strategy& root) {
+    unique_ptr<Strategy>& s = _strategies[worker];
+    if (!s) {
+        s.reset(new Strategy(root));
+    } else {
+        *s = root;
+    }
+    return *s;
+}
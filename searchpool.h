@@ -0,0 +1,72 @@
+#ifndef __SEARCHPOOL_H
+#define __SEARCHPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "SDL_stdinc.h"
+#include "common.h"
+
+class Strategy;
+
+/**
+ * Threads searching the root moves of alphabeta-parallel.
+ * They are started by the first search and kept for the next ones (the
+ * iterations of a move, and the moves of the programs playing whole
+ * games), instead of a thread per root move.
+ * Each worker keeps its own Strategy, set to the root again by every
+ * search, so that its buffers (the accumulators of the network) are only
+ * allocated once.
+ * A pool runs one search at a time.
+ */
+class SearchPool {
+   private:
+    Uint32 _size;
+    bool _affinity;
+    vector<thread> _threads;
+    //! search state of each worker, NULL until its first search
+    vector<unique_ptr<Strategy>> _strategies;
+
+    //! protects everything below
+    mutex _mutex;
+    //! a run starts (or the pool stops), a run is done
+    condition_variable _start;
+    condition_variable _done;
+    //! job of the current run
+    const function<void(Uint32)>* _job = NULL;
+    //! number of the current run, workers take part in each one once
+    Uint64 _run = 0;
+    //! workers of the current run, and those which have not returned
+    Uint32 _workers = 0;
+    Uint32 _running = 0;
+    bool _stop = false;
+
+    //! loop of the thread of worker
+    void work(Uint32 worker);
+
+   public:
+    //! size threads (0: one per core), each bound to its own core if
+    //! affinity
+    SearchPool(Uint32 size = 0, bool affinity = false);
+    ~SearchPool();
+
+    Uint32 size() const { return _size; }
+
+    /**
+     * Run job(worker) on workers threads (at most size()), worker going
+     * from 0 to workers - 1, and wait until all of them return.
+     * The threads are started by the first run that needs them.
+     */
+    void run(Uint32 workers, const function<void(Uint32)>& job);
+
+    /**
+     * Search state of worker, set to the position and search of root.
+     * Only the thread of worker uses it, during a run.
+     */
+    Strategy& strategy(Uint32 worker, const Strategy& root);
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "searchstats.h"
+
+void SearchStats::clear() {
+    nodes = 0;
+    leaves = 0;
+    moves = 0;
+    players = 0;
+    for (Uint32 i = 0; i < STAT_MAX_PLY; ++i) {
+        nodesPerPly[i] = 0;
+    }
+    ttProbes = 0;
+    ttHits = 0;
+    betaCutoffs = 0;
+    firstMoveCutoffs = 0;
+    researches = 0;
+    nullMoveCutoffs = 0;
+    reductions = 0;
+    futilityPrunes = 0;
+    keptPlayouts = 0;
+    rootAborts = 0;
+}
+
+void SearchStats::add(const SearchStats& other) {
+    nodes += other.nodes;
+    leaves += other.leaves;
+    moves += other.moves;
+    players += other.players;
+    for (Uint32 i = 0; i < STAT_MAX_PLY; ++i) {
+        nodesPerPly[i] += other.nodesPerPly[i];
+    }
+    ttProbes += other.ttProbes;
+    ttHits += other.ttHits;
+    betaCutoffs += other.betaCutoffs;
+    firstMoveCutoffs += other.firstMoveCutoffs;
+    researches += other.researches;
+    nullMoveCutoffs += other.nullMoveCutoffs;
+    reductions += other.reductions;
+    futilityPrunes += other.futilityPrunes;
+    keptPlayouts += other.keptPlayouts;
+    rootAborts += other.rootAborts;
+}
+
+void SearchStats::display() const {
+    cout << "number of nodes: " << nodes << '\n';
+    cout << "number of leaves: " << leaves << '\n';
+    cout << "number of moves: " << moves << '\n';
+    cout << "number of players: " << players << '\n';
+    if (players != 0) {
+        cout << "average number of move per blob: "
+             << (double)moves / players << '\n';
+    }
+    for (Uint32 i = 0; i < STAT_MAX_PLY && nodesPerPly[i] != 0; ++i) {
+        cout << "nodes at ply " << i << ": " << nodesPerPly[i] << '\n';
+    }
+    cout << "transposition table probes: " << ttProbes << ", hits: " << ttHits
+         << '\n';
+    cout << "beta cutoffs: " << betaCutoffs
+         << ", on first move: " << firstMoveCutoffs << '\n';
+    cout << "re-searches: " << researches << '\n';
+    cout << "null move cutoffs: " << nullMoveCutoffs
+         << ", reductions: " << reductions
+         << ", futility prunes: " << futilityPrunes << '\n';
+    if (keptPlayouts != 0) {
+        cout << "playouts kept in the tree: " << keptPlayouts << '\n';
+    }
+    if (rootAborts != 0) {
+        cout << "root moves searched again: " << rootAborts << '\n';
+    }
+}
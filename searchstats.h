@@ -0,0 +1,62 @@
+#ifndef __SEARCHSTATS_H
+#define __SEARCHSTATS_H
+
+#include "SDL_stdinc.h"
+#include "common.h"
+
+//! nodes deeper than this are counted with the last ply
+#define STAT_MAX_PLY 32
+
+/**
+ * Counters of one search thread.
+ * Every thread increments its own instance (aligned on a cache line so that
+ * two threads never write to the same line) and the instances are summed
+ * with add() once the threads are done.
+ * Only nodes is counted in every build, the other counters need _STAT.
+ */
+struct alignas(64) SearchStats {
+    //! number of positions visited
+    Uint64 nodes;
+    //! number of positions evaluated at the end of the search
+    Uint64 leaves;
+    //! number of moves generated
+    Uint64 moves;
+    //! blobs of the player to move, summed on all generations
+    Uint64 players;
+    //! number of positions visited at each ply
+    Uint64 nodesPerPly[STAT_MAX_PLY];
+    //! transposition table lookups
+    Uint64 ttProbes;
+    //! transposition table lookups that found the position
+    Uint64 ttHits;
+    //! number of nodes where a move reached beta
+    Uint64 betaCutoffs;
+    //! beta cutoffs produced by the first move searched
+    Uint64 firstMoveCutoffs;
+    //! number of nodes searched again with a wider window
+    Uint64 researches;
+    //! nodes cut by a null move (see computeMinMaxAlphaBetaMove)
+    Uint64 nullMoveCutoffs;
+    //! moves searched with a reduced depth
+    Uint64 reductions;
+    //! moves not searched by futility pruning
+    Uint64 futilityPrunes;
+    //! playouts of the previous moves kept in the tree of MCTS
+    Uint64 keptPlayouts;
+    //! root moves of the parallel search given up for the better alpha
+    //! another thread found, and searched again
+    Uint64 rootAborts;
+
+    SearchStats() { clear(); }
+
+    //! reset all counters
+    void clear();
+
+    //! add the counters of another thread
+    void add(const SearchStats& other);
+
+    //! print the counters on console
+    void display() const;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "searchtrace.h"
+
+#include <atomic>
+
+//! size above which _output is written to the file
+#define TRACE_WRITE_SIZE 65536
+
+//! identifier of the next trace, 0 is never used
+static atomic<Uint64> nextTraceId(1);
+
+//! buffer of the current thread and the trace it belongs to
+static thread_local Uint64 bufferOwner = 0;
+static thread_local TraceBuffer* threadBuffer = NULL;
+
+SearchTrace::SearchTrace() : _id(nextTraceId++), _file(NULL), _named(0) {}
+
+SearchTrace::~SearchTrace() {
+    if (_file != NULL) {
+        flush();
+        fclose(_file);
+    }
+}
+
+bool SearchTrace::open(const string& filename) {
+    _file = fopen(filename.c_str(), "w");
+    if (_file == NULL) {
+        perror("trace");
+        return false;
+    }
+    _origin = std::chrono::steady_clock::now();
+    _output = "[\n";
+    return true;
+}
+
+TraceBuffer& SearchTrace::buffer() {
+    if (bufferOwner != _id) {
+        lock_guard<mutex> lock(_mutex);
+        _buffers.push_back(unique_ptr<TraceBuffer>(new TraceBuffer));
+        _buffers.back()->tid = _buffers.size() - 1;
+        bufferOwner = _id;
+        threadBuffer = _buffers.back().get();
+    }
+    return *threadBuffer;
+}
+
+void SearchTrace::span(const char* name,
+                       Uint64 start,
+                       Sint32 depth,
+                       Sint32 score,
+                       Uint64 nodes) {
+    Uint64 end = now();
+    buffer().events.push_back(
+        {name, 'X', start, end - start, depth, score, nodes, movement(), false});
+}
+
+void SearchTrace::span(const char* name,
+                       Uint64 start,
+                       const movement& mv,
+                       Sint32 depth,
+                       Sint32 score,
+                       Uint64 nodes) {
+    Uint64 end = now();
+    buffer().events.push_back(
+        {name, 'X', start, end - start, depth, score, nodes, mv, true});
+}
+
+void SearchTrace::instant(const char* name,
+                          const movement& mv,
+                          Sint32 depth,
+                          Sint32 score) {
+    buffer().events.push_back(
+        {name, 'i', now(), 0, depth, score, 0, mv, true});
+}
+
+void SearchTrace::write(const TraceEvent& e, Uint32 tid) {
+    char line[256];
+    int n = snprintf(line,
+                     sizeof(line),
+                     "{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,"
+                     "\"ts\":%llu,",
+                     e.name,
+                     e.phase,
+                     tid,
+                     (unsigned long long)e.ts);
+    if (e.phase == 'X') {
+        n += snprintf(line + n,
+                      sizeof(line) - n,
+                      "\"dur\":%llu,",
+                      (unsigned long long)e.dur);
+    } else {
+        n += snprintf(line + n, sizeof(line) - n, "\"s\":\"t\",");
+    }
+    n += snprintf(line + n,
+                  sizeof(line) - n,
+                  "\"args\":{\"depth\":%d,\"score\":%d,\"nodes\":%llu",
+                  e.depth,
+                  e.score,
+                  (unsigned long long)e.nodes);
+    if (e.hasMove) {
+        n += snprintf(line + n,
+                      sizeof(line) - n,
+                      ",\"move\":\"%u,%u-%u,%u\"",
+                      e.move.ox,
+                      e.move.oy,
+                      e.move.nx,
+                      e.move.ny);
+    }
+    snprintf(line + n, sizeof(line) - n, "}},\n");
+    _output += line;
+
+    if (_output.size() >= TRACE_WRITE_SIZE) {
+        fwrite(_output.data(), 1, _output.size(), _file);
+        _output.clear();
+    }
+}
+
+void SearchTrace::flush() {
+    if (_file == NULL) {
+        return;
+    }
+
+    lock_guard<mutex> lock(_mutex);
+    for (; _named < _buffers.size(); ++_named) {
+        char line[128];
+        snprintf(line,
+                 sizeof(line),
+                 "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"tid\":%u,\"args\":{\"name\":\"%s %u\"}},\n",
+                 _named,
+                 _named == 0 ? "search" : "worker",
+                 _named);
+        _output += line;
+    }
+    for (auto& b : _buffers) {
+        for (const TraceEvent& e : b->events) {
+            write(e, b->tid);
+        }
+        b->events.clear();
+    }
+
+    fwrite(_output.data(), 1, _output.size(), _file);
+    _output.clear();
+    fflush(_file);
+}
@@ -0,0 +1,110 @@
+#ifndef __SEARCHTRACE_H
+#define __SEARCHTRACE_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+#include "SDL_stdinc.h"
+#include "common.h"
+
+/**
+ * Event recorded by the search.
+ * Names are string literals, so recording an event is only a few stores.
+ */
+struct TraceEvent {
+    //! name displayed by the viewer
+    const char* name;
+    //! 'X' for a span, 'i' for an instant
+    char phase;
+    //! microseconds since the trace was opened
+    Uint64 ts;
+    //! duration of a span in microseconds
+    Uint64 dur;
+    Sint32 depth;
+    Sint32 score;
+    Uint64 nodes;
+    //! move of the event, if hasMove
+    movement move;
+    bool hasMove;
+};
+
+//! events of one thread, only written by that thread
+struct alignas(64) TraceBuffer {
+    Uint32 tid;
+    vector<TraceEvent> events;
+};
+
+/**
+ * Search trace in the Chrome trace-event format (chrome://tracing or
+ * https://ui.perfetto.dev).
+ * Each thread appends its events to its own buffer without locking, the
+ * buffers are converted to JSON by flush(), which must only be called when
+ * no other thread is searching (between two iterations for instance).
+ * Events are streamed without closing the JSON array, which the viewers
+ * accept, so a trace stays readable if the process is killed.
+ */
+class SearchTrace {
+   private:
+    //! unique identifier, tells threads whether their buffer belongs to us
+    Uint64 _id;
+    FILE* _file;
+    std::chrono::steady_clock::time_point _origin;
+
+    //! protects _buffers when a new thread registers
+    std::mutex _mutex;
+    vector<unique_ptr<TraceBuffer>> _buffers;
+
+    //! number of buffers whose thread name was written
+    Uint32 _named;
+
+    //! text waiting to be written to _file
+    string _output;
+
+    //! buffer of the calling thread (registered on first use)
+    TraceBuffer& buffer();
+
+    //! convert one event to JSON in _output
+    void write(const TraceEvent& e, Uint32 tid);
+
+   public:
+    SearchTrace();
+    //! flush and close the file
+    ~SearchTrace();
+
+    //! start writing the trace to filename, returns false on error
+    bool open(const string& filename);
+
+    //! microseconds elapsed since open()
+    Uint64 now() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - _origin)
+            .count();
+    }
+
+    //! record a span started at start and finishing now
+    void span(const char* name,
+              Uint64 start,
+              Sint32 depth = 0,
+              Sint32 score = 0,
+              Uint64 nodes = 0);
+
+    //! record a span about one move
+    void span(const char* name,
+              Uint64 start,
+              const movement& mv,
+              Sint32 depth,
+              Sint32 score,
+              Uint64 nodes);
+
+    //! record an instant event about one move (e.g. a new best move)
+    void instant(const char* name,
+                 const movement& mv,
+                 Sint32 depth,
+                 Sint32 score);
+
+    //! write the events recorded so far
+    void flush();
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include<SDL.h>
 #include<string>
 #include<fstream>
+#include"../rulescore.h"
 
 #define GAME1P 1
 #define GAME2P 2
@@ -16,8 +17,8 @@ using namespace std;
  * */
 class rules {
 	private:
-		//!position of all blobs (-1 : no blob, else : player number)
-		Sint16 blobs[8][8];
+		//!position of all blobs and holes
+		boardState board;
 
 		//!is the game finished ?
 		bool finished;
@@ -30,8 +31,6 @@ class rules {
 
 	public:
 
-		//!pointer on the board
-		bool **holes;
 		//!old x position
 		Uint8 ox;
 		//!old y position
@@ -4,6 +4,7 @@
 #include <sys/shm.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 
 #define SHMEM_KEY1 425678
 int* first_is_new = NULL;
@@ -11,6 +12,9 @@ int* first_is_new = NULL;
 movement* first = NULL;
 #define SHMEM_KEY3 425680
 movement* second = NULL;
+#define SHMEM_KEY4 425681
+//! start and end of the search (see shmem_clock)
+Uint64* search_times = NULL;
 
 void shmem_init(bool init_move) {
     int shmid;
@@ -48,9 +52,23 @@ void shmem_init(bool init_move) {
         exit(1);
     }
 
+    // Create the segment.
+    if ((shmid = shmget(SHMEM_KEY4, 2 * sizeof(Uint64), IPC_CREAT | 0666)) <
+        0) {
+        perror("shmget");
+        exit(1);
+    }
+    // Now we attach the segment to our data space.
+    if ((search_times = (Uint64*)shmat(shmid, NULL, 0)) == (Uint64*)-1) {
+        perror("shmat");
+        exit(1);
+    }
+
     if (init_move) {
         *first = movement(0, 0, 0, 0);
         *first_is_new = true;
+        search_times[0] = 0;
+        search_times[1] = 0;
     }
 }
 
@@ -83,3 +101,34 @@ void shmem_set(movement& m) {
         (void)__sync_fetch_and_or(first_is_new, 1);
     }
 }
+
+Uint64 shmem_clock() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (Uint64)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void shmem_search_started() {
+    if (search_times == NULL) {
+        cout << "Use shmem_init() before shmem_search_started()." << endl;
+        exit(1);
+    }
+    search_times[0] = shmem_clock();
+}
+
+void shmem_search_done() {
+    if (search_times == NULL) {
+        cout << "Use shmem_init() before shmem_search_done()." << endl;
+        exit(1);
+    }
+    search_times[1] = shmem_clock();
+}
+
+void shmem_get_search_times(Uint64& start, Uint64& end) {
+    if (search_times == NULL) {
+        cout << "Use shmem_init() before shmem_get_search_times()." << endl;
+        exit(1);
+    }
+    start = search_times[0];
+    end = search_times[1];
+}
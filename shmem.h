@@ -18,4 +18,15 @@ movement shmem_get();
 //! save a new move
 void shmem_set(movement& m);
 
+//! microseconds of a clock shared by all processes (CLOCK_MONOTONIC)
+Uint64 shmem_clock();
+
+//! record when launchStrategy starts and finishes its search
+void shmem_search_started();
+void shmem_search_done();
+
+//! times recorded by the last search, 0 if not recorded (shmem_init(true)
+//! resets them)
+void shmem_get_search_times(Uint64& start, Uint64& end);
+
 #endif
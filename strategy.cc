@@ -1,29 +1,92 @@
 #include "strategy.h"
 
-#include <future>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <thread>
 
 #include "SDL_stdinc.h"
 #include "move.h"
-
-static bool isInBound(Sint8 x, Sint8 y) {
-    return x >= 0 && x < 8 && y >= 0 && y < 8;
+#include "searchpool.h"
+
+//! deepest iteration of iterative deepening
+#define MAX_SEARCH_DEPTH STAT_MAX_PLY
+
+//! half width of the first aspiration window, doubled at each failure
+#define ASPIRATION_WINDOW 8
+//! past this half width, the window is opened on the failing side
+#define ASPIRATION_MAX_WINDOW 256
+
+//! null move pruning: depth left from which the player to move tries to
+//! pass, and the reduction of the search of the pass
+#define NULL_MOVE_MIN_DEPTH 3
+#define NULL_MOVE_REDUCTION 2
+
+//! late move reductions: depth left from which moves are reduced, and the
+//! number of moves searched first to the full depth
+#define LMR_MIN_DEPTH 3
+#define LMR_FULL_MOVES 3
+
+//! futility pruning: depth left up to which moves are pruned
+#define FUTILITY_MAX_DEPTH 2
+
+//! first layers of the network allocated for a search, more are added when
+//! it goes deeper
+#define NETWORK_MAX_PLIES 64
+
+//! nodes between two looks of a thread at the stop of its search and the
+//! root alpha of the parallel search, well under a millisecond
+#define SEARCH_CHECK_NODES 128
+
+Strategy::Strategy(bidiarray<Sint16>& blobs,
+                   const bidiarray<bool>& holes,
+                   const Uint16 current_player,
+                   SearchContext& context)
+    : _current_player(current_player),
+      _rng(std::chrono::system_clock::now().time_since_epoch().count()),
+      _context(&context) {
+    _board.clear();
+    for (Uint8 x = 0; x < 8; ++x) {
+        for (Uint8 y = 0; y < 8; ++y) {
+            _board.set(x, y, blobs.get(x, y));
+            if (holes.get(x, y)) {
+                _board.holes |= cellMask(x, y);
+            }
+        }
+    }
 }
 
 bool Strategy::isPositionValid(Sint8 x, Sint8 y) const {
-    return isInBound(x, y) && _blobs.get(x, y) == -1 && !_holes.get(x, y);
+    return x >= 0 && x < 8 && y >= 0 && y < 8 &&
+           (_board.empty() & cellMask(x, y));
 }
 
-// The score of a player is its number of blobs
+// The score of a player is its number of blobs, only the hash (and the
+// network) is left
 void Strategy::initializeScores() {
-    _playerScore[0] = 0;
-    _playerScore[1] = 0;
+    _hash = 0;
+    for (Uint8 player = 0; player < 2; ++player) {
+        for (Uint64 cells = _board.blobs[player]; cells; cells &= cells - 1) {
+            _hash ^= zobristKeys[player][firstCell(cells)];
+        }
+    }
+
+    _accumulators.clear();
+    _accumulator = 0;
+    if (_context->network != NULL) {
+        _accumulators.resize(NETWORK_MAX_PLIES);
+        _context->network->refresh(_board.blobs[0],
+                                   _board.blobs[1],
+                                   _board.holes,
+                                   _accumulators[0]);
+    }
+}
+
+void Strategy::getBlobs(bidiarray<Sint16>& blobs) const {
     for (Uint8 x = 0; x < 8; ++x) {
         for (Uint8 y = 0; y < 8; ++y) {
-            Sint8 cellValue = _blobs.get(x, y);
-            if (cellValue != -1) {
-                ++_playerScore[cellValue];
-            }
+            blobs.set(x, y, _board.get(x, y));
         }
     }
 }
@@ -31,53 +94,108 @@ void Strategy::initializeScores() {
 void Strategy::switchPlayer() { _current_player ^= 1; }
 
 void Strategy::applyMove(const movement& mv) {
-    if (mv.distance() == 1) {
-        ++_playerScore[_current_player];
-    } else {
-        _blobs.set(mv.ox, mv.oy, -1);
+    if (mv.distance() != 1) {
+        _hash ^= zobristKeys[_current_player][mv.ox * 8 + mv.oy];
     }
-    _blobs.set(mv.nx, mv.ny, _current_player);
-
-    Sint8 _opponent_player = _current_player ^ 1;
-    for (Sint8 dx = -1; dx <= 1; ++dx) {
-        for (Sint8 dy = -1; dy <= 1; ++dy) {
-            Sint8 neighbourX = mv.nx + dx;
-            Sint8 neighbourY = mv.ny + dy;
-
-            if (isInBound(neighbourX, neighbourY)) {
-                Sint8 cellValue = _blobs.get(neighbourX, neighbourY);
+    _hash ^= zobristKeys[_current_player][mv.nx * 8 + mv.ny];
 
-                if (cellValue == _opponent_player) {
-                    --_playerScore[_opponent_player];
-                    _blobs.set(neighbourX, neighbourY, _current_player);
-                    ++_playerScore[_current_player];
-                }
-            }
+    Uint64 captured = _board.apply(_current_player, mv);
+    ++_ply;
+    if (!_accumulators.empty()) {
+        if (_accumulator + 1 == _accumulators.size()) {
+            _accumulators.resize(2 * _accumulators.size());
         }
+        _context->network->update(
+            _accumulators[_accumulator],
+            _accumulators[_accumulator + 1],
+            _current_player,
+            cellMask(mv.nx, mv.ny),
+            mv.distance() != 1 ? cellMask(mv.ox, mv.oy) : 0,
+            captured);
+        ++_accumulator;
+    }
+    for (; captured; captured &= captured - 1) {
+        Uint8 cell = firstCell(captured);
+        _hash ^= zobristKeys[0][cell] ^ zobristKeys[1][cell];
+    }
+}
+
+void Strategy::undoMove(const boardState& board, Uint64 hash) {
+    _board = board;
+    _hash = hash;
+    --_ply;
+    if (!_accumulators.empty()) {
+        --_accumulator;
     }
 }
 
 Sint32 Strategy::estimateCurrentScore() const {
-    return _playerScore[_current_player] - _playerScore[_current_player ^ 1];
+    return (Sint32)_board.score(_current_player) -
+           (Sint32)_board.score(_current_player ^ 1);
 }
 
-Uint8 Strategy::computeScore(extendedMovement& mv) const {
-    Uint16 score = mv.distance == 1;
+//! FNV-1a of size bytes, from the hash seed
+static Uint64 hashBytes(const void* data, size_t size, Uint64 seed) {
+    const Uint8* bytes = (const Uint8*)data;
+    for (size_t i = 0; i < size; ++i) {
+        seed = (seed ^ bytes[i]) * 1099511628211ULL;
+    }
+    return seed;
+}
 
-    Sint8 _opponent_player = _current_player ^ 1;
-    for (Sint8 dx = -1; dx <= 1; ++dx) {
-        for (Sint8 dy = -1; dy <= 1; ++dy) {
-            Sint8 neighbourX = mv.nx + dx;
-            Sint8 neighbourY = mv.ny + dy;
+Uint64 Strategy::evaluationKey() const {
+    if (_context->network != NULL) {
+        // (array by array, the alignment leaves padding between them)
+        const NetworkWeights& w = _context->network->weights();
+        Uint64 key = NETWORK_MAGIC;
+        key = hashBytes(w.input, sizeof(w.input), key);
+        key = hashBytes(w.inputBias, sizeof(w.inputBias), key);
+        key = hashBytes(w.layer, sizeof(w.layer), key);
+        key = hashBytes(w.layerBias, sizeof(w.layerBias), key);
+        key = hashBytes(w.output, sizeof(w.output), key);
+        return hashBytes(&w.outputBias, sizeof(w.outputBias), key);
+    }
+    if (_context->evaluator != NULL) {
+        const vector<Sint16>& w = _context->evaluator->weights();
+        return hashBytes(w.data(), w.size() * sizeof(Sint16), PATTERN_MAGIC);
+    }
+    return 0;
+}
 
-            if (isInBound(neighbourX, neighbourY)) {
-                Sint8 cellValue = _blobs.get(neighbourX, neighbourY);
-                score += (cellValue == _opponent_player) << 1;
-            }
+Sint32 Strategy::evaluate() const {
+    if (_context->network != NULL) {
+        if (_accumulators.empty()) {
+            return _context->network->evaluate(
+                _board.blobs[_current_player],
+                _board.blobs[_current_player ^ 1],
+                _board.holes);
         }
+        return _context->network->evaluate(_accumulators[_accumulator],
+                                           _current_player);
+    }
+    if (_context->evaluator == NULL) {
+        return estimateCurrentScore();
     }
+    return _context->evaluator->evaluate(_board.blobs[_current_player],
+                                         _board.blobs[_current_player ^ 1],
+                                         _board.holes);
+}
 
-    return score;
+Sint32 Strategy::terminalScore() const {
+    Sint32 difference = estimateCurrentScore();
+    if (difference > 0) {
+        return SCORE_WIN - (Sint32)_ply;
+    }
+    if (difference < 0) {
+        return -SCORE_WIN + (Sint32)_ply;
+    }
+    return 0;
+}
+
+Uint8 Strategy::computeScore(extendedMovement& mv) const {
+    Uint64 around = grow(cellMask(mv.nx, mv.ny));
+    return (mv.distance == 1) +
+           (cellCount(around & _board.blobs[_current_player ^ 1]) << 1);
 }
 
 bool compareMove(const extendedMovement& a, const extendedMovement& b) {
@@ -86,67 +204,49 @@ bool compareMove(const extendedMovement& a, const extendedMovement& b) {
 
 vector<movement>& Strategy::computeValidMoves(
     vector<movement>& validMoves) const {
-    for (Sint8 x = 0; x < 8; ++x) {
-        for (Sint8 y = 0; y < 8; ++y) {
-            if (_blobs.get(x, y) == _current_player) {
-                for (Sint8 dx = -2; dx <= 2; ++dx) {
-                    for (Sint8 dy = -2; dy <= 2; ++dy) {
-                        if (isPositionValid(x + dx, y + dy)) {
-                            auto mv = extendedMovement(x, y, x + dx, y + dy);
-                            mv.score = computeScore(mv);
-                            validMoves.push_back(mv);
-                        }
-                    }
-                }
-            }
+    // moves by the blobs they gain, moves of equal gain in the order of the
+    // shuffle seeded by _rng (the scores are lost once the moves are
+    // copied out, they are sorted before)
+    _scoredMoves.clear();
+    Uint64 empty = _board.empty();
+    for (Uint64 blobs = _board.blobs[_current_player]; blobs;
+         blobs &= blobs - 1) {
+        Uint8 from = firstCell(blobs);
+        for (Uint64 to = reach(1ULL << from) & empty; to; to &= to - 1) {
+            Uint8 cell = firstCell(to);
+            auto mv = extendedMovement(from >> 3, from & 7, cell >> 3, cell & 7);
+            mv.score = computeScore(mv);
+            _scoredMoves.push_back(mv);
         }
     }
 
-    shuffle(validMoves.begin(),
-            validMoves.end(),
-            std::default_random_engine(
-                std::chrono::system_clock::now().time_since_epoch().count()));
-    sort(validMoves.begin(), validMoves.end(), compareMove);
+    shuffle(_scoredMoves.begin(), _scoredMoves.end(), _rng);
+    sort(_scoredMoves.begin(), _scoredMoves.end(), compareMove);
+    validMoves.insert(
+        validMoves.end(), _scoredMoves.begin(), _scoredMoves.end());
 
     return validMoves;
 }
 
+void Strategy::moveFirst(vector<movement>& moves, const movement& mv) {
+    auto it = find(moves.begin(), moves.end(), mv);
+    if (it != moves.end()) {
+        rotate(moves.begin(), it, it + 1);
+    }
+}
+
 void Strategy::numberOfMoves(Sint32& firstPlayerMoves,
                              Sint32& secondPlayerMoves) const {
-    firstPlayerMoves = 0, secondPlayerMoves = 0;
-    for (Sint8 x = 0; x < 8; ++x) {
-        for (Sint8 y = 0; y < 8; ++y) {
-            if (_blobs.get(x, y) == 0) {
-                for (Sint8 dx = -2; dx <= 2; ++dx) {
-                    for (Sint8 dy = -2; dy <= 2; ++dy) {
-                        if (isPositionValid(x + dx, y + dy)) {
-                            ++firstPlayerMoves;
-                        }
-                    }
-                }
-            } else if (_blobs.get(x, y) == 1) {
-                for (Sint8 dx = -2; dx <= 2; ++dx) {
-                    for (Sint8 dy = -2; dy <= 2; ++dy) {
-                        if (isPositionValid(x + dx, y + dy)) {
-                            ++secondPlayerMoves;
-                        }
-                    }
-                }
-            }
+    Uint64 empty = _board.empty();
+    Sint32* moves[2] = {&firstPlayerMoves, &secondPlayerMoves};
+    for (Uint8 player = 0; player < 2; ++player) {
+        *moves[player] = 0;
+        for (Uint64 blobs = _board.blobs[player]; blobs; blobs &= blobs - 1) {
+            *moves[player] += cellCount(reach(blobs & -blobs) & empty);
         }
     }
 }
 
-Sint32 inf = 1000000;
-
-// Algorithm settings
-
-Uint32 minMaxDepth;
-
-Uint32 minMaxAlphaBetaDepth;
-
-Uint32 minMaxAlphaBetaParallelDepth;
-
 Uint32 Strategy::estimateMaxDepth(Sint64 limit, Uint32& depth) const {
     Uint32 d = 0;
     Sint32 moveNb[2];
@@ -155,147 +255,517 @@ Uint32 Strategy::estimateMaxDepth(Sint64 limit, Uint32& depth) const {
         depth = 4;
         return 0;
     }
-    Sint64 plays = moveNb[0];
-    while (plays * moveNb[(minMaxDepth & 1) ^ 1] <= limit) {
+    // players alternate, stop at depth 6 anyway (a player with a single
+    // move would never exceed the limit)
+    Sint64 plays = moveNb[_current_player];
+    while (d < 6 && plays * moveNb[_current_player ^ ((d + 1) & 1)] <= limit) {
         ++d;
-        plays *= moveNb[minMaxDepth & 1];
+        plays *= moveNb[_current_player ^ (d & 1)];
     }
-    depth = min(d, 6U);
+    depth = d;
     return plays;
 }
 
+bool Strategy::probe(TTData& entry) {
+    if (_context->table == NULL) {
+        return false;
+    }
+    bool found = _context->table->probe(hash(), entry);
 #ifdef _STAT
-atomic<Sint32> calculatedMoves;
-atomic<Sint32> moves;
-atomic<Sint32> players;
+    ++_stats.ttProbes;
+    _stats.ttHits += found;
 #endif
+    return found;
+}
+
+void Strategy::saveBestMove(const movement& mv, Sint32 score) {
+    if (_context->trace != NULL) {
+        _context->trace->instant("best move", mv, _context->rootDepth, score);
+    }
+    _context->bestMove = mv;
+    _context->bestScore = score;
+    _context->hasBestMove = true;
+    if (_context->saveBestMove != NULL) {
+        movement m = mv;
+        _context->saveBestMove(m);
+    }
+}
+
+void Strategy::traceRootMove(Uint64 start,
+                             Uint64 startNodes,
+                             const movement& mv,
+                             Sint32 score) const {
+    if (_context->trace != NULL) {
+        _context->trace->span("root move",
+                              start,
+                              mv,
+                              _context->rootDepth,
+                              score,
+                              _stats.nodes - startNodes);
+    }
+}
+
+bool Strategy::interrupted() {
+    if (_stopped || _aborted) {
+        return true;
+    }
+    if (_stats.nodes < _nextCheck) {
+        return false;
+    }
+    _nextCheck = _stats.nodes + SEARCH_CHECK_NODES;
+    _stopped = _context->stopped();
+    // a thread of the parallel search gives up its root move once another
+    // thread raised the root alpha past the bound the move started with
+    _aborted = _rootAlpha != NULL &&
+               _rootAlpha->load(memory_order_relaxed) > _rootBound;
+    return _stopped || _aborted;
+}
+
+Sint32 Strategy::searchEndgame() {
+    Uint64 start = traceStart();
+    Uint64 startNodes = _stats.nodes;
+
+    _context->rootDepth = 0;
+    EndgameSolver solver(_board.holes, _stats, [this] {
+        return _context->stopped();
+    });
+    Sint32 score = solver.solve(
+        _board.blobs[_current_player],
+        _board.blobs[_current_player ^ 1],
+        [this](const movement& mv, Sint32 score) { saveBestMove(mv, score); });
 
-void Strategy::computeBestMove() {
 #ifdef _STAT
-    calculatedMoves = 0;
-    moves = 0;
-    players = 0;
+    if (!_context->quiet) {
+        if (solver.stopped()) {
+            cout << "endgame stopped" << endl;
+        } else {
+            cout << "endgame solved"
+                 << (solver.exact() ? "" : " up to the jump budget")
+                 << ", final difference: " << score << endl;
+        }
+    }
 #endif
+    if (_context->trace != NULL) {
+        _context->trace->span(
+            "endgame", start, 0, score, _stats.nodes - startNodes);
+        _context->trace->flush();
+    }
+    return score;
+}
+
+Sint32 Strategy::searchIteration(const Engine& engine, Uint32 depth) {
+    Uint64 start = traceStart();
+    Uint64 startNodes = _stats.nodes;
+
+    _context->rootDepth = depth;
+    // (the moves played on the strategy before the search are not plies
+    // of the search)
+    _ply = 0;
+    Sint32 score = (this->*engine.search)(depth);
+    // (the score of a stopped iteration is only a bound of some moves)
+    if (!_stopped) {
+        _context->iterationScores[depth & 1] = score;
+        _context->hasIterationScore[depth & 1] = true;
+    }
+
+    if (_context->trace != NULL) {
+        _context->trace->span(
+            "iteration", start, depth, score, _stats.nodes - startNodes);
+        _context->trace->flush();
+    }
+    return score;
+}
+
+void Strategy::computeBestMove() {
+    _stats.clear();
     initializeScores();
-#ifdef _GREEDY
-    computeGreedyMove();
+    _context->hasBestMove = false;
+    _stopped = false;
+    _nextCheck = 0;
+
+    const EngineConfig& config = *_context->config;
+    _context->hasDeadline = config.time != 0;
+    _context->deadline = std::chrono::steady_clock::now() +
+                         std::chrono::milliseconds(config.time);
+
+    if (_context->table != NULL) {
+        _context->table->newSearch(_board.holes, evaluationKey());
+    }
+
+    const Engine* engine = findEngine(config.algorithm);
+    if (engine == NULL) {
+        engine = findEngine(defaultEngineConfig.algorithm);
+    }
+
+    // the opening book was searched deeper than any search of a game (its
+    // move is checked, in case of a collision of hashes)
+    BookEntry known;
+    if (_context->book != NULL && _context->book->holes() == _board.holes &&
+        _context->book->probe(hash(), known) && known.depth >= config.depth) {
+        movement mv(known.from >> 3, known.from & 7, known.to >> 3,
+                    known.to & 7);
+        if (_board.isLegal(_current_player, mv)) {
+#ifdef _STAT
+            if (!_context->quiet) {
+                cout << "algorithm: opening book" << endl;
+                cout << "depth: " << (Uint32)known.depth << endl;
+            }
 #endif
-#ifdef _MINMAX
-    // Determine depth by estimating number of calculations
-    Sint64 maxBoards = 4000000;
-    Uint32 plays = estimateMaxDepth(maxBoards, minMaxDepth);
+            saveBestMove(mv, known.score);
+            return;
+        }
+    }
 
+    // close to the end, searching to the end of the game beats any depth
+    // (the greedy algorithm is meant to stay greedy)
+    if ((engine->maxBoards != 0 || engine->anytime) && config.endgame != 0 &&
+        EndgameSolver::openCells(_board.holes,
+                                 _board.blobs[_current_player],
+                                 _board.blobs[_current_player ^ 1]) <=
+            config.endgame) {
 #ifdef _STAT
-    cout << "depth: " << minMaxDepth << endl;
-    cout << "estimation of the number of moves: " << plays << endl;
+        if (!_context->quiet) {
+            cout << "algorithm: endgame solver" << endl;
+        }
 #endif
-    computeMinMaxMove(minMaxDepth);
+        searchEndgame();
+#ifdef _STAT
+        if (!_context->quiet) {
+            _stats.display();
+        }
 #endif
-#ifdef _MINMAXALPHABETA
+        return;
+    }
+
     // Determine depth by estimating number of calculations
-    Sint64 maxBoards = 8000000000;
-    Uint32 plays = estimateMaxDepth(maxBoards, minMaxAlphaBetaDepth);
+    Uint32 depth = config.depth;
+    Uint32 plays = 0;
+    if (engine->maxBoards == 0) {
+        depth = 0;
+    } else if (depth == 0) {
+        plays = estimateMaxDepth(engine->maxBoards, depth);
+    }
 
 #ifdef _STAT
-    cout << "depth: " << minMaxAlphaBetaDepth << endl;
-    cout << "estimation of the number of moves: " << plays << endl;
+    if (!_context->quiet) {
+        cout << "algorithm: " << engine->name << endl;
+        cout << "depth: " << depth << endl;
+        cout << "estimation of the number of moves: " << plays << endl;
+    }
+#else
+    (void)plays;
 #endif
 
-    computeMinMaxAlphaBetaMove(minMaxAlphaBetaDepth, -inf, inf);
+    if (config.time == 0 || engine->maxBoards == 0) {
+        // (anytime searches watch the time budget themselves)
+        searchIteration(*engine, depth);
+    } else {
+        // iterative deepening: each iteration starts with the best move of
+        // the previous one, the one cut by the deadline keeps the best of
+        // the root moves it searched to the end; no iteration is started
+        // after half the budget as it would most likely not finish
+        auto start = std::chrono::steady_clock::now();
+        Uint32 maxDepth = config.depth != 0 ? config.depth : MAX_SEARCH_DEPTH;
+        for (Uint32 d = 1; d <= maxDepth; ++d) {
+            Sint32 score = searchIteration(*engine, d);
+            if (_stopped) {
+#ifdef _STAT
+                if (!_context->quiet) {
+                    cout << "depth " << d << " stopped" << endl;
+                }
 #endif
-#ifdef _MINMAXALPHABETAPARALLEL
-    // Determine depth by estimating number of calculations
-    Sint64 maxBoards = 8000000000;
-    minMaxAlphaBetaParallelDepth = Uint32 plays =
-        estimateMaxDepth(maxBoards, minMaxAlphaBetaParallelDepth);
+                break;
+            }
+#ifdef _STAT
+            if (!_context->quiet) {
+                cout << "depth " << d << " done, nodes: " << _stats.nodes
+                     << endl;
+            }
+#endif
+            // a deeper search finds the same forced win or loss
+            if (abs(score) >= SCORE_WIN_BOUND) {
+                break;
+            }
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+            if (elapsed.count() * 2 >= config.time) {
+                break;
+            }
+        }
+    }
+
+    // stopped before a root move was searched to the end, the best move
+    // of the ordering is better than none
+    if (_stopped && !_context->hasBestMove) {
+        vector<movement> validMoves;
+        computeValidMoves(validMoves);
+        if (validMoves.size() != 0) {
+            saveBestMove(validMoves[0], evaluate());
+        }
+    }
 
 #ifdef _STAT
-    cout << "depth: " << minMaxAlphaBetaParallelDepth << endl;
-    cout << "estimation of the number of moves: " << plays << endl;
+    if (!_context->quiet) {
+        _stats.display();
+    }
 #endif
+}
+
+SearchPool& Strategy::searchPool(unique_ptr<SearchPool>& own) const {
+    if (_context->pool != NULL) {
+        return *_context->pool;
+    }
+    const EngineConfig& config = *_context->config;
+    own.reset(new SearchPool(config.threads, config.affinity));
+    return *own;
+}
+
+Sint32 Strategy::searchGreedy(Uint32) { return computeGreedyMove(); }
+
+Sint32 Strategy::searchMcts(Uint32) {
+    const EngineConfig& config = *_context->config;
+    Uint32 threads =
+        config.threads != 0 ? config.threads : thread::hardware_concurrency();
+    // a tree kept from the previous moves is searched from the new position
+    unique_ptr<MonteCarloTree> own;
+    MonteCarloTree* tree = _context->tree;
+    if (tree == NULL) {
+        own.reset(new MonteCarloTree(_board, _current_player));
+        tree = own.get();
+    } else {
+        Uint32 kept = tree->reroot(_board, _current_player);
+#ifdef _STAT
+        _stats.keptPlayouts += kept;
+#else
+        (void)kept;
+#endif
+    }
+    unique_ptr<SearchPool> ownPool;
+    return tree->search(
+        config.time,
+        searchPool(ownPool),
+        threads,
+        _rng(),
+        _stats,
+        [this](const movement& mv, Sint32 score) { saveBestMove(mv, score); },
+        [this] { return _context->stopped(); });
+}
+
+Sint32 Strategy::searchMinMax(Uint32 depth) {
+    Sint32 score = computeMinMaxMove(depth);
+    // the search gives the turn back to the opponent when it returns
+    _current_player ^= 1;
+    return score;
+}
+
+Sint32 Strategy::searchAlphaBeta(Uint32 depth) {
+    Sint32 score =
+        computeMinMaxAlphaBetaMove(depth, -SCORE_INFINITY, SCORE_INFINITY);
+    _current_player ^= 1;
+    return score;
+}
+
+bool Strategy::guessScore(Uint32 depth, Sint32& guess) {
+    for (Uint32 parity = depth; parity <= depth + 1; ++parity) {
+        if (_context->hasIterationScore[parity & 1]) {
+            guess = _context->iterationScores[parity & 1];
+            return true;
+        }
+    }
+    TTData entry;
+    if (probe(entry)) {
+        guess = entry.score;
+        return true;
+    }
+    return false;
+}
+
+Sint32 Strategy::searchAspiration(Uint32 depth) {
+    Sint32 guess;
+    if (!guessScore(depth, guess)) {
+        return searchAlphaBeta(depth);
+    }
 
-    computeMinMaxAlphaBetaParallelMove(minMaxAlphaBetaParallelDepth, -inf, inf);
+    Sint32 window = ASPIRATION_WINDOW;
+    Sint32 alpha = max(guess - window, -SCORE_INFINITY);
+    Sint32 beta = min(guess + window, SCORE_INFINITY);
+    for (;;) {
+        Sint32 score = computeMinMaxAlphaBetaMove(depth, alpha, beta);
+        _current_player ^= 1;
+        if (_stopped) {
+            return score;
+        }
+
+        // search again with a wider window on the side that failed
+        if (score <= alpha && alpha > -SCORE_INFINITY) {
+            window *= 2;
+            alpha = window > ASPIRATION_MAX_WINDOW ? -SCORE_INFINITY
+                                                   : guess - window;
+        } else if (score >= beta && beta < SCORE_INFINITY) {
+            window *= 2;
+            beta = window > ASPIRATION_MAX_WINDOW ? SCORE_INFINITY
+                                                  : guess + window;
+        } else {
+            return score;
+        }
+#ifdef _STAT
+        ++_stats.researches;
 #endif
+    }
+}
+
+Sint32 Strategy::searchMtdf(Uint32 depth) {
+    Sint32 score = evaluate();
+    guessScore(depth, score);
+
+    // the searches are fail hard, they only tell on which side of the test
+    // value the score is: the test value moves by steps doubling as long
+    // as it fails on the same side
+    Sint32 lower = -SCORE_INFINITY;
+    Sint32 upper = SCORE_INFINITY;
+    Sint32 step = 1;
+    bool failedHigh = false;
+    bool first = true;
+    while (lower < upper) {
+        // the score is at least beta when the search fails high
+        Sint32 beta = max(lower + 1, min(upper, score));
+        Sint32 result = computeMinMaxAlphaBetaMove(depth, beta - 1, beta);
+        _current_player ^= 1;
+        if (_stopped) {
+            return result;
+        }
+
+        bool high = result >= beta;
+        step = !first && high == failedHigh ? step * 2 : 1;
+        failedHigh = high;
+        first = false;
+        if (high) {
+            lower = beta;
+            score = beta + step;
+        } else {
+            upper = beta - 1;
+            score = beta - step;
+        }
 #ifdef _STAT
-    cout << "numbers of calculated move : " << calculatedMoves << '\n';
-    cout << "numver of moves: " << moves << '\n';
-    cout << "numver of players: " << players << '\n';
-    cout << "average number of move per blob " << moves / players << '\n';
+        ++_stats.researches;
 #endif
+    }
+    return lower;
+}
+
+Sint32 Strategy::searchAlphaBetaParallel(Uint32 depth) {
+    return computeMinMaxAlphaBetaParallelMove(
+        depth, -SCORE_INFINITY, SCORE_INFINITY);
 }
 
 Sint32 Strategy::computeGreedyMove() {
+    countNode();
     vector<movement> validMoves;
     computeValidMoves(validMoves);
 
 #ifdef _STAT
-    calculatedMoves++;
-    moves += validMoves.size();
-    players += _playerScore[_current_player];
+    ++_stats.leaves;
+    _stats.moves += validMoves.size();
+    _stats.players += _board.score(_current_player);
 #endif
 
-    movement bestMove;
-
     if (validMoves.size() == 0) {
-        return estimateCurrentScore();
+        return _board.canMove(_current_player ^ 1) ? evaluate()
+                                                   : terminalScore();
     }
 
-#ifdef _GREEDY
-    _saveBestMove(validMoves[0]);
-#endif
-    return estimateCurrentScore() + ((extendedMovement)(validMoves[0])).score;
+    // the root of a search of depth 0 is a leaf, its move is the one
+    // gaining the most blobs
+    if (_context->rootDepth == 0) {
+        saveBestMove(validMoves[0], evaluate());
+    }
+    // (no bonus for the capture the player to move could make: futility
+    // relies on the leaves not counting it)
+    return evaluate();
 }
 
 Sint32 Strategy::computeMinMaxMove(Uint32 depth) {
+    // a player without blobs has lost, whatever the depth left
+    if (_board.blobs[0] == 0 || _board.blobs[1] == 0) {
+        Sint32 score = terminalScore();
+        _current_player ^= 1;
+        return score;
+    }
+
     if (depth == 0) {
         Sint32 score = computeGreedyMove();
         _current_player ^= 1;
         return score;
     }
 
+    countNode();
+    if (interrupted()) {
+        _current_player ^= 1;
+        return -SCORE_INFINITY;
+    }
     vector<movement> validMoves;
     computeValidMoves(validMoves);
-    Sint32 bestScore = -inf;
+    Sint32 bestScore = -SCORE_INFINITY;
 
 #ifdef _STAT
-    moves += validMoves.size();
-    players += _playerScore[_current_player];
+    _stats.moves += validMoves.size();
+    _stats.players += _board.score(_current_player);
 #endif
 
+    // the game is over when neither player can move, otherwise the
+    // player passes
+    if (validMoves.size() == 0 && !_board.canMove(_current_player ^ 1)) {
+        Sint32 score = terminalScore();
+        _current_player ^= 1;
+        return score;
+    }
+
     if (validMoves.size() == 0) {
-        bidiarray<Sint8> temp_blobs = _blobs;
-        Sint32 prevScore[2] = {_playerScore[0], _playerScore[1]};
+        boardState prevBoard = _board;
+        Uint64 prevHash = _hash;
 
         _current_player ^= 1;
+        ++_ply;
         Sint32 score = -computeMinMaxMove(depth - 1);
+        --_ply;
 
         if (score > bestScore) {
             bestScore = score;
         }
 
-        _blobs = temp_blobs;
-        _playerScore[0] = prevScore[0];
-        _playerScore[1] = prevScore[1];
+        _board = prevBoard;
+        _hash = prevHash;
+    }
+
+    bool root = depth == _context->rootDepth;
+    if (root && _context->hasBestMove) {
+        moveFirst(validMoves, _context->bestMove);
     }
 
     for (auto mv : validMoves) {
-        bidiarray<Sint8> temp_blobs = _blobs;
-        Sint32 prevScore[2] = {_playerScore[0], _playerScore[1]};
+        boardState prevBoard = _board;
+        Uint64 prevHash = _hash;
+        Uint64 start = root ? traceStart() : 0;
+        Uint64 startNodes = _stats.nodes;
 
         applyMove(mv);
         _current_player ^= 1;
         Sint32 score = -computeMinMaxMove(depth - 1);
 
+        undoMove(prevBoard, prevHash);
+        if (_stopped) {
+            break;
+        }
+
+        if (root) {
+            traceRootMove(start, startNodes, mv, score);
+        }
         if (score > bestScore) {
             bestScore = score;
-            if (depth == minMaxDepth) {
-                _saveBestMove(mv);
+            if (root) {
+                saveBestMove(mv, score);
             }
         }
-
-        _blobs = temp_blobs;
-        _playerScore[0] = prevScore[0];
-        _playerScore[1] = prevScore[1];
     }
 
     _current_player ^= 1;
@@ -305,93 +775,270 @@ Sint32 Strategy::computeMinMaxMove(Uint32 depth) {
 Sint32 Strategy::computeMinMaxAlphaBetaMove(Uint32 depth,
                                             Sint32 alpha,
                                             Sint32 beta) {
+    // the node searched after a pass, or verifying one, does not pass
+    bool nullMoveAllowed = !_noNullMove;
+    _noNullMove = false;
+
+    // a player without blobs has lost, whatever the depth left
+    if (_board.blobs[0] == 0 || _board.blobs[1] == 0) {
+        Sint32 score = max(alpha, min(beta, terminalScore()));
+        _current_player ^= 1;
+        return score;
+    }
+
     if (depth == 0) {
         Sint32 score = computeGreedyMove();
         _current_player ^= 1;
         return score;
     }
+
+    countNode();
+    // the score of an interrupted node is never used: the root keeps the
+    // moves searched to the end, and a root move given up by a thread of
+    // the parallel search is searched again with the new bound
+    if (interrupted()) {
+        _current_player ^= 1;
+        return alpha;
+    }
+
+    // the threads of the parallel search start below the root
+    bool root = depth == _context->rootDepth;
+
+    // no line from here wins sooner than winning at the next move, nor
+    // loses sooner than now: these bounds may end the search at once
+    if (!root) {
+        alpha = max(alpha, -SCORE_WIN + (Sint32)_ply);
+        beta = min(beta, SCORE_WIN - (Sint32)_ply - 1);
+        if (alpha >= beta) {
+            _current_player ^= 1;
+            return alpha;
+        }
+    }
+    Sint32 alphaOrig = alpha;
+
+    // a result of the table at least as deep may end the search here,
+    // otherwise its move is searched first
+    TTData entry;
+    bool found = probe(entry);
+    if (found) {
+        entry.score = scoreFromTable(entry.score, (Sint32)_ply);
+    }
+    if (found && !root && entry.depth >= depth) {
+        if (entry.flag == TT_EXACT ||
+            (entry.flag == TT_LOWER && entry.score >= beta) ||
+            (entry.flag == TT_UPPER && entry.score <= alpha)) {
+            _current_player ^= 1;
+            return max(alpha, min(beta, entry.score));
+        }
+    }
+
     vector<movement> validMoves;
     computeValidMoves(validMoves);
 
 #ifdef _STAT
-    moves += validMoves.size();
-    players += _playerScore[_current_player];
+    _stats.moves += validMoves.size();
+    _stats.players += _board.score(_current_player);
 #endif
 
+    // the game is over when neither player can move, otherwise the
+    // player passes
+    if (validMoves.size() == 0 && !_board.canMove(_current_player ^ 1)) {
+        Sint32 score = max(alpha, min(beta, terminalScore()));
+        _current_player ^= 1;
+        return score;
+    }
+
     if (validMoves.size() == 0) {
-        bidiarray<Sint8> temp_blobs = _blobs;
-        Sint32 prevScore[2] = {_playerScore[0], _playerScore[1]};
+        boardState prevBoard = _board;
+        Uint64 prevHash = _hash;
 
         _current_player ^= 1;
+        ++_ply;
         Sint32 score = -computeMinMaxAlphaBetaMove(depth - 1, -beta, -alpha);
+        --_ply;
 
-        _blobs = temp_blobs;
-        _playerScore[0] = prevScore[0];
-        _playerScore[1] = prevScore[1];
+        _board = prevBoard;
+        _hash = prevHash;
 
         if (score > alpha) {
             alpha = score;
         }
 
         if (score >= beta) {
+#ifdef _STAT
+            ++_stats.betaCutoffs;
+            ++_stats.firstMoveCutoffs;
+#endif
             _current_player ^= 1;
             return beta;
         }
     }
 
-    for (auto mv : validMoves) {
-        bidiarray<Sint8> temp_blobs = _blobs;
-        Sint32 prevScore[2] = {_playerScore[0], _playerScore[1]};
+    const EngineConfig& config = *_context->config;
+    Sint32 difference = estimateCurrentScore();
+    Uint64 theirs = _board.blobs[_current_player ^ 1];
+
+    /*
+     * Null move: when even passing (a real move of the game when one has
+     * no other) keeps the player above beta, a search of the pass reduced
+     * by NULL_MOVE_REDUCTION usually proves it with far fewer nodes. Not
+     * being able to move may also be better than moving here (when every
+     * move opens cells to the opponent), so a pass that fails high is
+     * verified by a search of the moves of the node, reduced as much.
+     */
+    if (config.nullMove && nullMoveAllowed && !root &&
+        depth >= NULL_MOVE_MIN_DEPTH && validMoves.size() != 0 &&
+        beta < SCORE_WIN_BOUND && _board.canMove(_current_player ^ 1) &&
+        evaluate() >= beta) {
+        _current_player ^= 1;
+        _noNullMove = true;
+        ++_ply;
+        Sint32 score = -computeMinMaxAlphaBetaMove(
+            depth - 1 - NULL_MOVE_REDUCTION, -beta, -beta + 1);
+        --_ply;
+
+        if (score >= beta) {
+            _noNullMove = true;
+            score = computeMinMaxAlphaBetaMove(
+                depth - NULL_MOVE_REDUCTION, beta - 1, beta);
+            _current_player ^= 1;
+            if (score >= beta) {
+#ifdef _STAT
+                ++_stats.nullMoveCutoffs;
+#endif
+                _current_player ^= 1;
+                return beta;
+            }
+        }
+    }
+
+    if (root && _context->hasBestMove) {
+        moveFirst(validMoves, _context->bestMove);
+    } else if (found && entry.hasMove) {
+        moveFirst(validMoves, entry.move);
+    }
+
+    movement bestMove;
+    bool hasBestMove = false;
+    for (auto& mv : validMoves) {
+        Uint64 destination = cellMask(mv.nx, mv.ny);
+        bool quiet = !(grow(destination) & theirs);
+
+        /*
+         * Futility: scored by the blob difference, a move without capture
+         * gains at most the blob of a copy, and the reply of the opponent
+         * never gains it anything back. With one or two plies left, such a
+         * move cannot reach alpha from a difference of alpha - 1 or less,
+         * as long as the opponent can still move after it (otherwise the
+         * game may end and be scored as a win). The patterns and the
+         * network give no such bound.
+         */
+        if (config.futility && evaluatesMaterial() && !root &&
+            depth <= FUTILITY_MAX_DEPTH && quiet && difference + 1 <= alpha &&
+            cellCount(reach(theirs) & _board.empty() & ~destination) >=
+                depth) {
+#ifdef _STAT
+            ++_stats.futilityPrunes;
+#endif
+            continue;
+        }
+
+        boardState prevBoard = _board;
+        Uint64 prevHash = _hash;
+        Uint64 start = root ? traceStart() : 0;
+        Uint64 startNodes = _stats.nodes;
 
         applyMove(mv);
         _current_player ^= 1;
-        Sint32 score = -computeMinMaxAlphaBetaMove(depth - 1, -beta, -alpha);
 
-        _blobs = temp_blobs;
-        _playerScore[0] = prevScore[0];
-        _playerScore[1] = prevScore[1];
+        // late moves without capture are first searched one ply shallower
+        // with a null window, and again to the full depth if they reach
+        // alpha: after the move of the table, the moves come by the blobs
+        // they gain (see computeValidMoves), the late ones are the quiet
+        // jumps and the last quiet copies
+        Sint32 score;
+        if (config.lmr && !root && depth >= LMR_MIN_DEPTH && quiet &&
+            &mv - &validMoves[0] >= LMR_FULL_MOVES) {
+#ifdef _STAT
+            ++_stats.reductions;
+#endif
+            score = -computeMinMaxAlphaBetaMove(depth - 2, -alpha - 1, -alpha);
+            if (score > alpha) {
+#ifdef _STAT
+                ++_stats.researches;
+#endif
+                _current_player ^= 1;
+                score = -computeMinMaxAlphaBetaMove(depth - 1, -beta, -alpha);
+            }
+        } else {
+            score = -computeMinMaxAlphaBetaMove(depth - 1, -beta, -alpha);
+        }
 
+        undoMove(prevBoard, prevHash);
+        if (_stopped || _aborted) {
+            break;
+        }
+
+        if (root) {
+            traceRootMove(start, startNodes, mv, score);
+        }
         if (score > alpha) {
             alpha = score;
-            if (depth == minMaxAlphaBetaDepth) {
-                _saveBestMove(mv);
+            bestMove = mv;
+            hasBestMove = true;
+            if (root) {
+                saveBestMove(mv, score);
             }
         }
 
         if (score >= beta) {
+#ifdef _STAT
+            ++_stats.betaCutoffs;
+            _stats.firstMoveCutoffs += &mv == &validMoves[0];
+#endif
+            if (_context->table != NULL) {
+                _context->table->store(
+                    hash(),
+                    {scoreToTable(beta, (Sint32)_ply),
+                     (Uint8)depth,
+                     TT_LOWER,
+                     mv,
+                     true});
+            }
             _current_player ^= 1;
             return beta;
         }
     }
 
+    if (_context->table != NULL && !_stopped && !_aborted) {
+        _context->table->store(
+            hash(),
+            {scoreToTable(alpha, (Sint32)_ply),
+             (Uint8)depth,
+             (Uint8)(alpha > alphaOrig ? TT_EXACT : TT_UPPER),
+             bestMove,
+             hasBestMove});
+    }
     _current_player ^= 1;
     return alpha;
 }
 
-Sint32 launchThread(Strategy* current_strategy,
-                    movement* mv,
-                    Uint32 depth,
-                    Sint32 alpha,
-                    Sint32 beta) {
-    Strategy s(*current_strategy);
-    s.applyMove(*mv);
-    s.switchPlayer();
-    return -s.computeMinMaxAlphaBetaMove(depth - 1, -beta, -alpha);
-}
-
 Sint32 Strategy::computeMinMaxAlphaBetaParallelMove(Uint32 depth,
                                                     Sint32 alpha,
                                                     Sint32 beta) {
-    // don't save moves
-    minMaxAlphaBetaDepth = inf;
-
+    countNode();
     vector<movement> validMoves;
     computeValidMoves(validMoves);
-    cout << "size: " << validMoves.size() << '\n';
+    if (_context->hasBestMove) {
+        moveFirst(validMoves, _context->bestMove);
+    }
 
 #ifdef _STAT
-    moves += validMoves.size();
-    players += _playerScore[_current_player];
+    if (!_context->quiet) {
+        cout << "size: " << validMoves.size() << '\n';
+    }
+    _stats.moves += validMoves.size();
+    _stats.players += _board.score(_current_player);
 #endif
 
     Sint16 iterativeBranches = validMoves.size() / 4;
@@ -400,43 +1047,98 @@ Sint32 Strategy::computeMinMaxAlphaBetaParallelMove(Uint32 depth,
     for (Sint16 i = 0; i < iterativeBranches; ++i) {
         auto mv = validMoves[i];
         if (i == 0) {
-            _saveBestMove(mv);
+            saveBestMove(mv, alpha);
         }
-        bidiarray<Sint8> temp_blobs = _blobs;
-        Sint32 prevScore[2] = {_playerScore[0], _playerScore[1]};
+        boardState prevBoard = _board;
+        Uint64 prevHash = _hash;
+        Uint64 start = traceStart();
+        Uint64 startNodes = _stats.nodes;
 
         applyMove(mv);
         _current_player ^= 1;
 
         Sint32 score = -computeMinMaxAlphaBetaMove(depth - 1, -beta, -alpha);
 
-        _blobs = temp_blobs;
-        _playerScore[0] = prevScore[0];
-        _playerScore[1] = prevScore[1];
+        undoMove(prevBoard, prevHash);
+        if (_stopped) {
+            return alpha;
+        }
 
+        traceRootMove(start, startNodes, mv, score);
         if (score > alpha) {
             alpha = score;
-            _saveBestMove(mv);
+            saveBestMove(mv, score);
         }
     }
 
-    vector<future<Sint32>> scoreFuture(validMoves.size() - iterativeBranches);
-    for (size_t i = 0; i < validMoves.size() - iterativeBranches; ++i) {
-        scoreFuture[i] = async(launch::async,
-                               launchThread,
-                               this,
-                               &validMoves[i + iterativeBranches],
-                               depth,
-                               alpha,
-                               beta);
-    }
+    // the other moves are handed out one at a time to the threads of the
+    // pool: a thread takes the next one as soon as it is done with a move,
+    // and searches it from its own copy of the root with the best alpha
+    // known at that time
+    unique_ptr<SearchPool> own;
+    SearchPool* pool = &searchPool(own);
+    atomic<size_t> next(iterativeBranches);
+    // alpha as the threads see it during their searches: a move started
+    // with an older one is given up and searched again with the new one
+    // (see computeMinMaxAlphaBetaMove)
+    atomic<Sint32> sharedAlpha(alpha);
+    // protects alpha and the best move once the threads have started
+    mutex best;
+    auto searchMoves = [&](Uint32 worker) {
+        Strategy& s = pool->strategy(worker, *this);
+        s._rootAlpha = &sharedAlpha;
+        size_t i;
+        while ((i = next++) < validMoves.size()) {
+            const movement& mv = validMoves[i];
+            Uint64 start = s.traceStart();
+            Uint64 startNodes = s._stats.nodes;
+            Sint32 score;
+            for (;;) {
+                s._rootBound = sharedAlpha.load(memory_order_relaxed);
+                boardState prevBoard = s._board;
+                Uint64 prevHash = s._hash;
+
+                s.applyMove(mv);
+                s._current_player ^= 1;
+
+                score = -s.computeMinMaxAlphaBetaMove(
+                    depth - 1, -beta, -s._rootBound);
+
+                s.undoMove(prevBoard, prevHash);
+                if (!s._aborted || s._stopped) {
+                    break;
+                }
+#ifdef _STAT
+                ++s._stats.rootAborts;
+#endif
+                s._aborted = false;
+            }
+            // the other threads see the stop by themselves, the root learns
+            // it from any of them
+            if (s._stopped) {
+                lock_guard<mutex> lock(best);
+                _stopped = true;
+                break;
+            }
 
-    for (size_t i = 0; i < validMoves.size() - iterativeBranches; ++i) {
-        Sint32 score = scoreFuture[i].get();
-        if (score > alpha) {
-            alpha = score;
-            _saveBestMove(validMoves[i + iterativeBranches]);
+            s.traceRootMove(start, startNodes, mv, score);
+            lock_guard<mutex> lock(best);
+            if (score > alpha) {
+                alpha = score;
+                sharedAlpha.store(score, memory_order_relaxed);
+                saveBestMove(mv, score);
+            }
         }
+        s._rootAlpha = NULL;
+        lock_guard<mutex> lock(best);
+        _stats.add(s._stats);
+    };
+
+    Uint64 start = traceStart();
+    pool->run(min(validMoves.size() - iterativeBranches, (size_t)pool->size()),
+              searchMoves);
+    if (_context->trace != NULL) {
+        _context->trace->span("wait", start);
     }
 
     return alpha;
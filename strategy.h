@@ -1,60 +1,228 @@
 #ifndef __STRATEGY_H
 #define __STRATEGY_H
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+
 #include "SDL_stdinc.h"
 #include "bidiarray.h"
+#include "endgame.h"
+#include "engine.h"
 #include "extendedMovement.h"
+#include "mcts.h"
 #include "move.h"
+#include "rulescore.h"
+#include "searchcontext.h"
+#include "searchstats.h"
 
 class Strategy {
    private:
-    //! array containing all blobs on the board
-    bidiarray<Sint8> _blobs;
-    //! an array of booleans indicating for each cell whether it is a hole or
-    //! not.
-    const bidiarray<bool>& _holes;
+    //! blobs and holes of the board (the score of a player is the number
+    //! of its blobs)
+    boardState _board;
     //! Current player
     Uint16 _current_player;
 
-    //! Call this function to save your best move.
-    //! Multiple call can be done each turn,
-    //! Only the last move saved will be used.
-    void (*_saveBestMove)(movement&);
+    //! Zobrist hash of the blobs (see hash() for the player)
+    Uint64 _hash = 0;
+
+    //! First layer of the network of the context (if any): the one of the
+    //! current position, _accumulators[_accumulator], above those of the
+    //! positions the search came from. applyMove computes the next one
+    //! from the cells of the move, undoMove goes back to the previous one.
+    vector<NetworkAccumulator> _accumulators;
+    Uint32 _accumulator = 0;
+
+    //! Plies played from the root of the search to the current position:
+    //! the moves of applyMove and the passes, null moves included
+    Uint32 _ply = 0;
+
+    //! Shuffles moves of equal score, seeded so that searches can be replayed
+    mutable std::default_random_engine _rng;
+
+    //! Moves of computeValidMoves with their scores, kept to be reused
+    mutable vector<extendedMovement> _scoredMoves;
+
+    //! Parameters and results of the search, shared with the other threads
+    SearchContext* _context;
+
+    //! Counters of the search, owned by the thread running this strategy
+    SearchStats _stats;
+
+    //! The next node of alphabeta may not try a null move (it follows one,
+    //! or verifies one)
+    bool _noNullMove = false;
+
+    //! In a thread of the parallel search: the alpha of the root, raised
+    //! by all the threads (NULL in the other searches), the one the root
+    //! move being searched started with, and whether its search was given
+    //! up since alpha went past it
+    const atomic<Sint32>* _rootAlpha = NULL;
+    Sint32 _rootBound = 0;
+    bool _aborted = false;
+
+    //! The search of this thread saw the stop of its context: every node
+    //! returns at once, and _stats.nodes from which it looks again at the
+    //! context and the root alpha
+    bool _stopped = false;
+    Uint64 _nextCheck = 0;
+
+    //! The node must return at once, without storing anything: the search
+    //! is stopped, or its root move given up (see _rootAlpha)
+    bool interrupted();
+
+    //! The threads of the context, or new ones kept in own for this
+    //! search only
+    SearchPool& searchPool(unique_ptr<SearchPool>& own) const;
+
+    //! Count a node visited, at _ply from the root
+    void countNode() {
+        ++_stats.nodes;
+#ifdef _STAT
+        ++_stats.nodesPerPly[_ply < STAT_MAX_PLY ? _ply : STAT_MAX_PLY - 1];
+#endif
+    }
+
+    //! Score of the finished game for the player to move, _ply from the
+    //! root
+    Sint32 terminalScore() const;
+
+    //! Scores of wins are stored in the table relative to the position,
+    //! they are relative to the root during the search
+    static Sint32 scoreToTable(Sint32 score, Sint32 ply) {
+        return score >= SCORE_WIN_BOUND    ? score + ply
+               : score <= -SCORE_WIN_BOUND ? score - ply
+                                           : score;
+    }
+    static Sint32 scoreFromTable(Sint32 score, Sint32 ply) {
+        return score >= SCORE_WIN_BOUND    ? score - ply
+               : score <= -SCORE_WIN_BOUND ? score + ply
+                                           : score;
+    }
+
+    //! Hash of the position, including the player to move
+    Uint64 hash() const { return _hash ^ (_current_player ? zobristSide : 0); }
+
+    //! The leaves are scored by the blob difference (no patterns or
+    //! network)
+    bool evaluatesMaterial() const {
+        return _context->evaluator == NULL && _context->network == NULL;
+    }
+
+    //! Key of the evaluation of the leaves, salting the transposition
+    //! table: 0 for material, a hash of the weights for the patterns and
+    //! the network
+    Uint64 evaluationKey() const;
+
+    //! Look for the position in the transposition table
+    bool probe(TTData& entry);
+
+    //! Move mv to the front of moves (if it is one of them)
+    static void moveFirst(vector<movement>& moves, const movement& mv);
+
+    //! Save mv as the best move found so far, with its score
+    void saveBestMove(const movement& mv, Sint32 score);
+
+    //! Time at which the search of a root move starts (0 when not tracing)
+    Uint64 traceStart() const {
+        return _context->trace != NULL ? _context->trace->now() : 0;
+    }
+
+    //! Record the search of a root move started at start
+    void traceRootMove(Uint64 start,
+                       Uint64 startNodes,
+                       const movement& mv,
+                       Sint32 score) const;
+
+    //! Solve the end of the game exactly, returns the final blob difference
+    Sint32 searchEndgame();
 
-    // Array containing the score of both players
-    Sint32 _playerScore[2] = {0, 0};
+    //! Score of the root found by a previous search (the last iteration of
+    //! the parity of depth, the last one, or the table), false if none
+    bool guessScore(Uint32 depth, Sint32& guess);
+
+    //! Search the root to depth with engine, returns the score
+    Sint32 searchIteration(const Engine& engine, Uint32 depth);
 
    public:
     // Constructor from a current situation
     Strategy(bidiarray<Sint16>& blobs,
              const bidiarray<bool>& holes,
              const Uint16 current_player,
-             void (*saveBestMove)(movement&))
-        : _holes(holes),
-          _current_player(current_player),
-          _saveBestMove(saveBestMove) {
-        for (Sint8 i = 0; i < 8; ++i) {
-            for (Sint8 j = 0; j < 8; ++j) {
-                _blobs.set(i, j, blobs.get(i, j));
-            }
-        }
-    }
+             SearchContext& context);
 
     // Copy constructor
     Strategy(const Strategy& St)
-        : _blobs(St._blobs),
-          _holes(St._holes),
-          _current_player(St._current_player) {
-        _playerScore[0] = St._playerScore[0];
-        _playerScore[1] = St._playerScore[1];
+        : _board(St._board),
+          _current_player(St._current_player),
+          _hash(St._hash),
+          _accumulators(St._accumulators),
+          _accumulator(St._accumulator),
+          _rng(St._rng),
+          _context(St._context) {}
+
+    // Copy of the position and search of St, in a strategy reused by the
+    // searches of a thread (see SearchPool): its buffers are kept, its
+    // counters cleared
+    Strategy& operator=(const Strategy& St) {
+        _board = St._board;
+        _current_player = St._current_player;
+        _hash = St._hash;
+        _accumulators = St._accumulators;
+        _accumulator = St._accumulator;
+        _rng = St._rng;
+        _context = St._context;
+        _stats.clear();
+        _noNullMove = false;
+        _rootAlpha = NULL;
+        _aborted = false;
+        _stopped = false;
+        _nextCheck = 0;
+        return *this;
     }
 
     // Destructor
     ~Strategy() {}
 
     /**
-     * Initializes the score of both players in score array.
-     * The score of a player is the number of blobs he has.
+     * Seed the generator used to order moves of equal score.
+     * Two searches with the same seed visit the same tree.
+     */
+    void setSeed(Uint32 seed) { _rng.seed(seed); }
+
+    /**
+     * Number of nodes visited by the last search
+     */
+    Uint64 nodes() const { return _stats.nodes; }
+
+    /**
+     * Counters of the last search, summed on all threads
+     */
+    const SearchStats& stats() const { return _stats; }
+
+    /**
+     * Hash of the position with the player to move, the key of the opening
+     * books (valid once initializeScores has been called)
+     */
+    Uint64 key() const { return hash(); }
+
+    /**
+     * Player who has to play
+     */
+    Uint16 currentPlayer() const { return _current_player; }
+
+    /**
+     * Copy the current board in blobs (-1 for empty cells)
+     */
+    void getBlobs(bidiarray<Sint16>& blobs) const;
+
+    /**
+     * Computes the hash of the position (and the first layer of the
+     * network).
+     * (The score of a player is the number of blobs he has, counted on the
+     * board when needed.)
      */
     void initializeScores();
 
@@ -69,6 +237,11 @@ class Strategy {
      */
     void applyMove(const movement& mv);
 
+    /**
+     * Undo the last move applied: back to board and hash, saved before it
+     */
+    void undoMove(const boardState& board, Uint64 hash);
+
     /**
      * Returns a boolean that indicates whether the player
      * can play in position (x, y)
@@ -88,7 +261,8 @@ class Strategy {
                        Sint32& secondPlayerMoves) const;
 
     /**
-     * Returns the score associated to a move.
+     * Blobs the move gains to the player to move: one for a copy, two per
+     * blob captured (the change of the blob difference).
      */
     Uint8 computeScore(extendedMovement& mv) const;
 
@@ -97,16 +271,36 @@ class Strategy {
      */
     Sint32 estimateCurrentScore() const;
 
+    /**
+     * Score of the position for the player to move with the evaluation of
+     * the config: estimateCurrentScore, or the patterns or the network (in
+     * their points)
+     */
+    Sint32 evaluate() const;
+
     /**
      * Estimates the maximal depth p so that the number of boards of depth p is less than limit.
      */
     Uint32 estimateMaxDepth(Sint64 limit, Uint32& depth) const;
 
     /**
-     * Find the best move.
+     * Find the best move with the algorithm and limits of the config, or
+     * with the endgame solver once few enough cells are empty.
      */
     void computeBestMove();
 
+    /**
+     * Root searches of the engine registry (see engines in engine.cc).
+     * They save the best move and return its score.
+     */
+    Sint32 searchGreedy(Uint32 depth);
+    Sint32 searchMinMax(Uint32 depth);
+    Sint32 searchAlphaBeta(Uint32 depth);
+    Sint32 searchAspiration(Uint32 depth);
+    Sint32 searchMtdf(Uint32 depth);
+    Sint32 searchAlphaBetaParallel(Uint32 depth);
+    Sint32 searchMcts(Uint32 depth);
+
     /**
      * Finds a move using a greedy strategy
      */
@@ -123,7 +317,9 @@ class Strategy {
     Sint32 computeMinMaxAlphaBetaMove(Uint32 depth, Sint32 alpha, Sint32 beta);
 
     /**
-     * Finds a move using the minmax algorithm and parallelism
+     * Finds a move using the minmax algorithm and parallelism: the first
+     * moves are searched in order for a good alpha, the others by the
+     * threads of the SearchPool of the context
      */
     Sint32 computeMinMaxAlphaBetaParallelMove(Uint32 depth,
                                               Sint32 alpha,
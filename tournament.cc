@@ -0,0 +1,439 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "mapfile.h"
+#include "searchpool.h"
+#include "strategy.h"
+
+//! games longer than this are adjudicated on blobs (jumps can loop forever)
+#define MAX_PLIES 400
+
+//! an engine configuration taking part in the tournament
+struct player {
+    //! as given on the command line
+    string name;
+    EngineConfig config;
+    //! its evaluation, loaded once (NULL for material)
+    PatternEvaluator patterns;
+    const PatternEvaluator* evaluator = NULL;
+    NetworkEvaluator weights;
+    const NetworkEvaluator* network = NULL;
+
+    // totals on all its moves, protected by the results mutex
+    Uint64 nodes = 0;
+    Uint64 moves = 0;
+    //! time spent searching, in ms
+    double time = 0;
+};
+
+//! counters of the moves of one game, added to the players when it ends
+struct moveCounters {
+    Uint64 nodes = 0;
+    Uint64 moves = 0;
+    double time = 0;
+};
+
+//! state shared by the threads playing the games
+struct tournament {
+    player players[2];
+    vector<string> mapNames;
+    vector<bidiarray<bool>> maps;
+    Uint32 games = 0;
+
+    // sprt settings, used when sprt is true
+    bool sprt = false;
+    double elo0 = 0;
+    double elo1 = 5;
+    double alpha = 0.05;
+    double beta = 0.05;
+
+    //! next game to play
+    atomic<Uint32> next{0};
+    //! set when the sprt reached a conclusion
+    atomic<bool> stop{false};
+
+    //! protects everything below and the players' totals
+    mutex results;
+    //! wins, draws and losses of the first player
+    Uint32 wins = 0;
+    Uint32 draws = 0;
+    Uint32 losses = 0;
+};
+
+//! expected score of a player that is elo points stronger
+static double scoreFromElo(double elo) { return 1 / (1 + pow(10, -elo / 400)); }
+
+//! elo difference giving the expected score (logistic model)
+static double eloFromScore(double score) {
+    score = max(1e-6, min(1 - 1e-6, score));
+    return -400 * log10(1 / score - 1);
+}
+
+//! mean score of the first player and the variance of one game's score
+static void scoreStatistics(Uint32 wins,
+                            Uint32 draws,
+                            Uint32 losses,
+                            double& score,
+                            double& variance) {
+    double n = wins + draws + losses;
+    score = (wins + draws / 2.0) / n;
+    variance = (wins * pow(1 - score, 2) + draws * pow(0.5 - score, 2) +
+                losses * pow(score, 2)) /
+               n;
+}
+
+/**
+ * Log-likelihood ratio of elo1 against elo0 (normal approximation of the
+ * generalized SPRT on the game scores).
+ */
+static double logLikelihoodRatio(const tournament& t) {
+    Uint32 n = t.wins + t.draws + t.losses;
+    if (n == 0) {
+        return 0;
+    }
+    double score, variance;
+    scoreStatistics(t.wins, t.draws, t.losses, score, variance);
+    if (variance == 0) {
+        return 0;
+    }
+    double s0 = scoreFromElo(t.elo0);
+    double s1 = scoreFromElo(t.elo1);
+    return (s1 - s0) * (2 * score - s0 - s1) / (2 * variance / n);
+}
+
+/**
+ * Read an engine configuration: a name=value,name=value list
+ * (e.g. algo=alphabeta,tt=16) or a file in the engine.cfg format.
+ */
+static bool parsePlayer(const string& arg, player& p) {
+    p.name = arg;
+    if (arg.find('=') == string::npos) {
+        if (!loadEngineConfig(p.config, arg)) {
+            cerr << "unable to read " << arg << endl;
+            return false;
+        }
+        return true;
+    }
+
+    istringstream options(arg);
+    string option;
+    while (getline(options, option, ',')) {
+        size_t equal = option.find('=');
+        if (equal == string::npos ||
+            !setEngineOption(
+                p.config, option.substr(0, equal), option.substr(equal + 1))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Play one game between sides[0] (red, moves first) and sides[1] (blue).
+ * Returns the blobs of red minus the blobs of blue, or +-64 when a side
+ * plays an illegal move.
+ */
+static Sint32 playGame(const bidiarray<bool>& holes,
+                       Uint32 seed,
+                       player* sides[2],
+                       TranspositionTable* tables[2],
+                       MonteCarloTree* trees[2],
+                       SearchPool* pools[2],
+                       moveCounters counters[2]) {
+    bidiarray<Sint16> blobs;
+    initialBlobs(blobs);
+
+    // the referee: checks and applies the moves with the rules core
+    boardState board;
+    board.clear();
+    for (Uint8 x = 0; x < 8; ++x) {
+        for (Uint8 y = 0; y < 8; ++y) {
+            board.set(x, y, blobs.get(x, y));
+            if (holes.get(x, y)) {
+                board.holes |= cellMask(x, y);
+            }
+        }
+    }
+
+    // the book of the map of each side that plays it, like launchStrategy
+    OpeningBook books[2];
+    for (Uint16 s = 0; s < 2; ++s) {
+        if (sides[s]->config.book) {
+            books[s].openForHoles(holesMask(holes));
+        }
+    }
+
+    Uint16 side = 0;
+    for (Uint32 ply = 0; ply < MAX_PLIES && !board.gameOver(); ++ply) {
+        if (!board.canMove(side)) {
+            side ^= 1;
+        }
+
+        // a new search for each move, like launchStrategy does (with the
+        // table of the previous ones if it is a file, and the tree of mcts
+        // if it is kept)
+        for (Uint8 x = 0; x < 8; ++x) {
+            for (Uint8 y = 0; y < 8; ++y) {
+                blobs.set(x, y, board.get(x, y));
+            }
+        }
+        if (!tables[side]->persistent()) {
+            tables[side]->clear();
+        }
+        SearchContext context(sides[side]->config,
+                              NULL,
+                              tables[side],
+                              NULL,
+                              &books[side],
+                              trees[side],
+                              sides[side]->evaluator,
+                              sides[side]->network,
+                              pools[side]);
+        context.quiet = true;
+        Strategy s(blobs, holes, side, context);
+        s.setSeed(seed * MAX_PLIES + ply);
+
+        auto start = std::chrono::steady_clock::now();
+        s.computeBestMove();
+        auto end = std::chrono::steady_clock::now();
+        counters[side].nodes += s.nodes();
+        counters[side].time +=
+            std::chrono::duration<double, std::milli>(end - start).count();
+        ++counters[side].moves;
+
+        if (!context.hasBestMove || !board.isLegal(side, context.bestMove)) {
+            cerr << sides[side]->name << " played an illegal move" << endl;
+            return side == 0 ? -64 : 64;
+        }
+        board.apply(side, context.bestMove);
+        side ^= 1;
+    }
+
+    return (Sint32)board.score(0) - (Sint32)board.score(1);
+}
+
+/**
+ * Thread playing games until all are played or the sprt stops.
+ * Game 2k and 2k+1 are played on the same map with the same seed, the
+ * first player being red in the first one and blue in the second one.
+ */
+static void playGames(tournament* t) {
+    // one table per side, allocated once per thread
+    TranspositionTable table0(t->players[0].config.ttSize,
+                              t->players[0].config.ttFile);
+    TranspositionTable table1(t->players[1].config.ttSize,
+                              t->players[1].config.ttFile);
+    // and a tree per side for mcts, kept during a game
+    unique_ptr<MonteCarloTree> tree0, tree1;
+    if (t->players[0].config.reuse) {
+        tree0.reset(new MonteCarloTree());
+    }
+    if (t->players[1].config.reuse) {
+        tree1.reset(new MonteCarloTree());
+    }
+    // and the threads of the parallel search of each side
+    SearchPool pool0(t->players[0].config.threads,
+                     t->players[0].config.affinity);
+    SearchPool pool1(t->players[1].config.threads,
+                     t->players[1].config.affinity);
+
+    Uint32 game;
+    while (!t->stop && (game = t->next++) < t->games) {
+        Uint32 pair = game / 2;
+        Uint32 map = pair % t->maps.size();
+        bool swapped = game % 2 == 1;
+
+        player* sides[2] = {&t->players[swapped], &t->players[!swapped]};
+        TranspositionTable* tables[2] = {swapped ? &table1 : &table0,
+                                         swapped ? &table0 : &table1};
+        MonteCarloTree* trees[2] = {swapped ? tree1.get() : tree0.get(),
+                                    swapped ? tree0.get() : tree1.get()};
+        SearchPool* pools[2] = {swapped ? &pool1 : &pool0,
+                                swapped ? &pool0 : &pool1};
+        moveCounters counters[2];
+        Sint32 difference =
+            playGame(t->maps[map], pair, sides, tables, trees, pools, counters);
+        // from the point of view of the first player
+        if (swapped) {
+            difference = -difference;
+        }
+
+        lock_guard<mutex> lock(t->results);
+        for (Uint8 side = 0; side < 2; ++side) {
+            sides[side]->nodes += counters[side].nodes;
+            sides[side]->moves += counters[side].moves;
+            sides[side]->time += counters[side].time;
+        }
+        if (difference > 0) {
+            ++t->wins;
+        } else if (difference < 0) {
+            ++t->losses;
+        } else {
+            ++t->draws;
+        }
+
+        printf("game %u %s %s: %+d, %u-%u-%u\n",
+               game,
+               t->mapNames[map].c_str(),
+               swapped ? "blue" : "red",
+               difference,
+               t->wins,
+               t->draws,
+               t->losses);
+        fflush(stdout);
+
+        if (t->sprt) {
+            double llr = logLikelihoodRatio(*t);
+            if (llr <= log(t->beta / (1 - t->alpha)) ||
+                llr >= log((1 - t->beta) / t->alpha)) {
+                t->stop = true;
+            }
+        }
+    }
+}
+
+static void displayPlayer(const player& p) {
+    printf("%s: %llu moves, %.0f nodes/sec, %.2f ms per move\n",
+           p.name.c_str(),
+           (unsigned long long)p.moves,
+           p.time > 0 ? p.nodes / (p.time / 1000) : 0,
+           p.moves > 0 ? p.time / p.moves : 0);
+}
+
+static void displayUsage() {
+    printf("usage: ./tournament [options] engine1 engine2\n");
+    printf(
+        "	engine is a file in the %s format or a list of options "
+        "(algo=alphabeta,tt=16,time=100)\n",
+        ENGINE_CONFIG_FILE);
+    printf("	-games <n> number of games (default: 2 per map).\n");
+    printf(
+        "	-concurrency <n> games played at the same time (default: "
+        "number of cores).\n");
+    printf(
+        "	-sprt <elo0> <elo1> stop once engine1 is shown to be elo0 or "
+        "elo1 stronger.\n");
+    printf("	-alpha <a> -beta <b> error rates of the sprt (default: 0.05).\n");
+    printf("engine options:\n");
+    displayEngineUsage();
+}
+
+/** Main of tournament
+ * Plays engine1 against engine2 on every map with both colours, several
+ * games at the same time, and reports the results of engine1: wins, draws,
+ * losses, elo difference with its 95% confidence interval and the speed of
+ * both engines.
+ * With -sprt, the tournament stops as soon as the sequential probability
+ * ratio test accepts elo0 (engine1 is not elo1 stronger) or elo1.
+ */
+int main(int argc, char** argv) {
+    tournament t;
+    Uint32 concurrency = thread::hardware_concurrency();
+
+    vector<string> engineArgs;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "-games") == 0 && hasValue) {
+            t.games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-concurrency") == 0 && hasValue) {
+            concurrency = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-sprt") == 0 && i + 2 < argc) {
+            t.sprt = true;
+            t.elo0 = atof(argv[++i]);
+            t.elo1 = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-alpha") == 0 && hasValue) {
+            t.alpha = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-beta") == 0 && hasValue) {
+            t.beta = atof(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            engineArgs.push_back(argv[i]);
+        } else {
+            displayUsage();
+            return 1;
+        }
+    }
+    if (engineArgs.size() != 2 || !parsePlayer(engineArgs[0], t.players[0]) ||
+        !parsePlayer(engineArgs[1], t.players[1])) {
+        displayUsage();
+        return 1;
+    }
+    for (auto& p : t.players) {
+        p.evaluator = loadEvaluator(p.config, p.patterns);
+        p.network = loadNetwork(p.config, p.weights);
+    }
+
+    t.mapNames = listMaps();
+    for (const string& name : t.mapNames) {
+        bidiarray<bool> holes;
+        if (!loadMap(MAPS_DIRECTORY + name, holes)) {
+            cerr << "unable to load map " << name << endl;
+            return 1;
+        }
+        t.maps.push_back(holes);
+    }
+    if (t.maps.empty()) {
+        cerr << "no map in " << MAPS_DIRECTORY << endl;
+        return 1;
+    }
+    if (t.games == 0) {
+        t.games = 2 * t.maps.size();
+    }
+    if (concurrency == 0) {
+        concurrency = 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    vector<thread> threads;
+    for (Uint32 i = 0; i < concurrency; ++i) {
+        threads.push_back(thread(playGames, &t));
+    }
+    for (thread& th : threads) {
+        th.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    Uint32 played = t.wins + t.draws + t.losses;
+    if (played == 0) {
+        return 1;
+    }
+    double score, variance;
+    scoreStatistics(t.wins, t.draws, t.losses, score, variance);
+    double margin = 1.96 * sqrt(variance / played);
+
+    printf("\n%s vs %s\n", t.players[0].name.c_str(), t.players[1].name.c_str());
+    printf("games: %u, wins: %u, draws: %u, losses: %u\n",
+           played,
+           t.wins,
+           t.draws,
+           t.losses);
+    printf("score: %.1f%%\n", 100 * score);
+    printf("elo: %+.1f [%+.1f, %+.1f] (95%%)\n",
+           eloFromScore(score),
+           eloFromScore(score - margin),
+           eloFromScore(score + margin));
+    if (t.sprt) {
+        double llr = logLikelihoodRatio(t);
+        double lower = log(t.beta / (1 - t.alpha));
+        double upper = log((1 - t.beta) / t.alpha);
+        printf("sprt elo0=%g elo1=%g: llr %.2f [%.2f, %.2f], %s\n",
+               t.elo0,
+               t.elo1,
+               llr,
+               lower,
+               upper,
+               llr >= upper   ? "H1 accepted"
+               : llr <= lower ? "H0 accepted"
+                              : "inconclusive");
+    }
+    displayPlayer(t.players[0]);
+    displayPlayer(t.players[1]);
+    printf("total time: %.1f s\n",
+           std::chrono::duration<double>(end - start).count());
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include "transposition.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+Uint64 zobristKeys[2][64];
+Uint64 zobristSide;
+
+//! splitmix64, used to fill the zobrist keys
+static Uint64 nextRandom(Uint64& state) {
+    Uint64 z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+//! fills the keys before main starts
+static struct zobristInitializer {
+    zobristInitializer() {
+        Uint64 state = 0x626c6f62776172ULL;
+        for (Uint8 p = 0; p < 2; ++p) {
+            for (Uint8 i = 0; i < 64; ++i) {
+                zobristKeys[p][i] = nextRandom(state);
+            }
+        }
+        zobristSide = nextRandom(state);
+    }
+} zobristInit;
+
+// data word: score (32 bits) | depth (8) | flag (2) | has move (1) | move
+// (12) | generation (8)
+#define GENERATION_SHIFT 55
+
+static Uint64 generationOf(Uint64 w) { return (w >> GENERATION_SHIFT) & 0xff; }
+
+static Uint64 pack(const TTData& d) {
+    Uint64 move = d.move.ox | (d.move.oy << 3) | (d.move.nx << 6) |
+                  (d.move.ny << 9);
+    return (Uint64)(Uint32)d.score | ((Uint64)d.depth << 32) |
+           ((Uint64)d.flag << 40) | ((Uint64)d.hasMove << 42) | (move << 43);
+}
+
+static TTData unpack(Uint64 w) {
+    TTData d;
+    d.score = (Sint32)(Uint32)w;
+    d.depth = (w >> 32) & 0xff;
+    d.flag = (w >> 40) & 3;
+    d.hasMove = (w >> 42) & 1;
+    Uint64 move = w >> 43;
+    d.move = movement(move & 7, (move >> 3) & 7, (move >> 6) & 7, (move >> 9) & 7);
+    return d;
+}
+
+TranspositionTable::TranspositionTable(Uint32 sizeMB, const string& filename)
+    : _entries(NULL), _mask(0), _header(NULL), _generation(0), _salt(0) {
+    if (sizeMB == 0) {
+        return;
+    }
+    Uint64 count = 1;
+    while (count * 2 * sizeof(entry) <= (Uint64)sizeMB << 20) {
+        count *= 2;
+    }
+    _mask = count - 1;
+    if (!filename.empty()) {
+        if (mapFile(filename, count)) {
+            return;
+        }
+        cerr << "unable to map " << filename
+             << ", the table is kept in memory" << endl;
+    }
+    _entries = new entry[count];
+    clear();
+}
+
+bool TranspositionTable::mapFile(const string& filename, Uint64 count) {
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        return false;
+    }
+    // only the processes opening the file at the same time wait for each
+    // other (for the one creating it), the entries are never locked
+    flock(fd, LOCK_EX);
+
+    // only an empty file, just created, is sized: other processes may have
+    // mapped an existing one, which must keep its size and its entries
+    size_t length = sizeof(fileHeader) + count * sizeof(entry);
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 &&
+        ((size_t)st.st_size == length ||
+         (st.st_size == 0 && ftruncate(fd, length) == 0))) {
+        data = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (data != MAP_FAILED) {
+        // a new file is zeros, which are empty entries
+        fileHeader* header = (fileHeader*)data;
+        if (header->magic == 0) {
+            header->magic = TT_FILE_MAGIC;
+            header->version = TT_FILE_VERSION;
+            header->count = count;
+        }
+        if (header->magic == TT_FILE_MAGIC &&
+            header->version == TT_FILE_VERSION && header->count == count) {
+            _header = header;
+            _entries = (entry*)(header + 1);
+        } else {
+            munmap(data, length);
+        }
+    }
+
+    flock(fd, LOCK_UN);
+    // the mapping stays valid once the file is closed
+    close(fd);
+    if (_header == NULL) {
+        cerr << filename << " is not a table of " << count << " entries of "
+             << "this version" << endl;
+    }
+    return _header != NULL;
+}
+
+TranspositionTable::~TranspositionTable() {
+    if (_header != NULL) {
+        munmap(_header, sizeof(fileHeader) + (_mask + 1) * sizeof(entry));
+    } else {
+        delete[] _entries;
+    }
+}
+
+void TranspositionTable::newSearch(Uint64 holes, Uint64 evaluation) {
+    Uint64 generation = _header != NULL
+                            ? _header->generation.fetch_add(1) + 1
+                            : _generation + 1;
+    _generation = generation & 0xff;
+
+    // splitmix64 of the holes and the evaluation (0 for material)
+    Uint64 z = (holes ^ evaluation * 0xff51afd7ed558ccdULL) +
+               0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    _salt = z ^ (z >> 31);
+}
+
+void TranspositionTable::clear() {
+    for (Uint64 i = 0; _entries != NULL && i <= _mask; ++i) {
+        _entries[i].check.store(0, memory_order_relaxed);
+        _entries[i].data.store(0, memory_order_relaxed);
+    }
+}
+
+bool TranspositionTable::probe(Uint64 hash, TTData& result) const {
+    hash ^= _salt;
+    const entry& e = _entries[hash & _mask];
+    Uint64 data = e.data.load(memory_order_relaxed);
+    if ((e.check.load(memory_order_relaxed) ^ data) != hash || data == 0) {
+        return false;
+    }
+    result = unpack(data);
+    return true;
+}
+
+void TranspositionTable::store(Uint64 hash, const TTData& result) {
+    hash ^= _salt;
+    entry& e = _entries[hash & _mask];
+    Uint64 data = e.data.load(memory_order_relaxed);
+    bool sameKey = (e.check.load(memory_order_relaxed) ^ data) == hash;
+    if (data != 0 && unpack(data).depth > result.depth &&
+        (sameKey || generationOf(data) == _generation)) {
+        return;
+    }
+    data = pack(result) | (_generation << GENERATION_SHIFT);
+    e.check.store(hash ^ data, memory_order_relaxed);
+    e.data.store(data, memory_order_relaxed);
+}
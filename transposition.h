@@ -0,0 +1,118 @@
+#ifndef __TRANSPOSITION_H
+#define __TRANSPOSITION_H
+
+#include <atomic>
+
+#include "SDL_stdinc.h"
+#include "common.h"
+
+//! the score is the exact value of the position
+#define TT_EXACT 0
+//! the real value is at least the score (beta cutoff)
+#define TT_LOWER 1
+//! the real value is at most the score (no move reached alpha)
+#define TT_UPPER 2
+
+/**
+ * Zobrist keys: the hash of a position is the xor of the keys of its
+ * blobs, and of zobristSide when the second player has to play.
+ * They come from a fixed seed so that hashes are the same in every process.
+ */
+extern Uint64 zobristKeys[2][64];
+extern Uint64 zobristSide;
+
+//! result of a search stored in the table
+struct TTData {
+    Sint32 score;
+    //! depth the position was searched to
+    Uint8 depth;
+    //! TT_EXACT, TT_LOWER or TT_UPPER
+    Uint8 flag;
+    //! best move (or move of the cutoff), if hasMove
+    movement move;
+    bool hasMove;
+};
+
+//! first bytes of a table file ("blobtt", little-endian)
+#define TT_FILE_MAGIC 0x7474626f6c62ULL
+//! version of the table files, changes with the entries or the hashes
+#define TT_FILE_VERSION 2
+
+/**
+ * Hash table of search results shared by all the threads of a search.
+ * An entry is two 64-bit words: the data and the key xored with the data,
+ * so a lookup racing with a store of another thread sees a wrong key and
+ * is ignored instead of returning half of each entry.
+ *
+ * The table may be a file mapped by every process using it, so that the
+ * results of a search serve the next moves and games, and the processes
+ * searching at the same time: the entries are updated the same way, the
+ * atomics being lock free. Positions are hashed without the holes, so the
+ * keys are salted with the map of the search, and with its evaluation:
+ * the scores of material, patterns and networks are not comparable.
+ * Each search is a new generation: an entry of this search is only
+ * replaced by a deeper result, an entry of a previous one by any result
+ * of another position (a position keeps its deepest result).
+ */
+class TranspositionTable {
+   private:
+    struct entry {
+        std::atomic<Uint64> check;
+        std::atomic<Uint64> data;
+    };
+
+    //! start of a table file, followed by the entries
+    struct alignas(64) fileHeader {
+        Uint64 magic;
+        Uint32 version;
+        Uint32 unused;
+        //! number of entries
+        Uint64 count;
+        //! generation of the last search of all the processes
+        std::atomic<Uint64> generation;
+    };
+
+    entry* _entries;
+    //! number of entries - 1 (the size is a power of two)
+    Uint64 _mask;
+    //! the mapped file, NULL if the table is in memory
+    fileHeader* _header;
+    //! generation of the current search (8 bits)
+    Uint64 _generation;
+    //! key of the map of the current search, xored with the hashes
+    Uint64 _salt;
+
+    //! map filename holding count entries, false if it cannot be used
+    bool mapFile(const string& filename, Uint64 count);
+
+   public:
+    /**
+     * Table using at most sizeMB megabytes, 0 makes a disabled table.
+     * If filename is given, the table is this file, created if needed. A
+     * file of another size or version is left as it is (other processes
+     * may be using it), and the table is kept in memory.
+     */
+    TranspositionTable(Uint32 sizeMB, const string& filename = "");
+    ~TranspositionTable();
+
+    //! false if the table has no entry
+    bool enabled() const { return _entries != NULL; }
+
+    //! true if the table is a file
+    bool persistent() const { return _header != NULL; }
+
+    //! forget all the entries
+    void clear();
+
+    //! start a search on the map with these holes, and the evaluation of
+    //! this key (see Strategy::evaluationKey)
+    void newSearch(Uint64 holes, Uint64 evaluation);
+
+    //! look for hash, returns false if it is not in the table
+    bool probe(Uint64 hash, TTData& result) const;
+
+    //! save the result of a search, replacing shallower results
+    void store(Uint64 hash, const TTData& result);
+};
+
+#endif
@@ -0,0 +1,1008 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "mapfile.h"
+#include "strategy.h"
+
+//! first bytes of a sample file ("blobsmpl" read as a little-endian word)
+#define SAMPLE_MAGIC 0x6c706d73626f6c62ULL
+//! version of the format, changes with the layout of the samples
+#define SAMPLE_VERSION 1
+
+//! self-play games played by default
+#define DEFAULT_GAMES 1000
+//! plies played at random at the start of each game, so that games differ
+#define DEFAULT_RANDOM_PLIES 6
+//! self-play games longer than this are cut (jumps can loop forever)
+#define MAX_PLIES 300
+
+//! passes on the samples by default
+#define DEFAULT_ITERATIONS 400
+//! step of Adam, in points
+#define LEARNING_RATE 0.5
+//! L2 penalty of the pattern weights (per sample and squared point)
+#define REGULARIZATION 1e-7
+
+//! passes on the samples training the network by default
+#define NETWORK_ITERATIONS 30
+//! samples of a step of the training of the network
+#define NETWORK_BATCH 4096
+//! step of Adam for the network
+#define NETWORK_LEARNING_RATE 1e-3
+//! one sample in this many validates the network instead of training it
+#define NETWORK_VALIDATION 20
+
+//! start of a sample file, followed by the samples until its end
+struct sampleHeader {
+    Uint64 magic;
+    Uint32 version;
+    Uint32 unused;
+};
+
+/**
+ * A position of a self-play game and how the game ended.
+ * The holes are kept with each sample so that the samples of several runs
+ * and maps can be merged in one file (-merge, a file holds one header).
+ */
+struct trainingSample {
+    //! blobs of the player to move and of the other one
+    Uint64 mine;
+    Uint64 theirs;
+    Uint64 holes;
+    //! 1 if the player to move won, 0 for a draw, -1 if it lost
+    Sint8 result;
+    //! up to 32 bytes
+    Uint8 unused[7];
+};
+
+/**
+ * Self-play games writing their positions to a sample file, played by
+ * several threads.
+ */
+class samplePlayer {
+   private:
+    const EngineConfig& config;
+    const PatternEvaluator* evaluator;
+    const NetworkEvaluator* network;
+    vector<bidiarray<bool>> maps;
+    Uint32 games;
+    Uint32 randomPlies;
+    //! the games of a run differ from those of a run with another seed
+    Uint32 seed;
+
+    //! next game to play
+    atomic<Uint32> next{0};
+    //! protects the file and the counters
+    mutex output;
+    ofstream& outfile;
+    Uint64 samples = 0;
+    Uint32 played = 0;
+
+    //! play game, returns its samples
+    vector<trainingSample> play(Uint32 game, TranspositionTable& table) {
+        const bidiarray<bool>& holes = maps[game % maps.size()];
+        seed_seq seeds{seed, game};
+        default_random_engine rng(seeds);
+
+        bidiarray<Sint16> blobs;
+        initialBlobs(blobs);
+        boardState board;
+        board.clear();
+        for (Uint8 x = 0; x < 8; ++x) {
+            for (Uint8 y = 0; y < 8; ++y) {
+                board.set(x, y, blobs.get(x, y));
+                if (holes.get(x, y)) {
+                    board.holes |= cellMask(x, y);
+                }
+            }
+        }
+
+        vector<trainingSample> result;
+        vector<Uint16> players;
+        Uint16 side = 0;
+        for (Uint32 ply = 0; ply < MAX_PLIES && !board.gameOver(); ++ply) {
+            if (!board.canMove(side)) {
+                side ^= 1;
+            }
+            for (Uint8 x = 0; x < 8; ++x) {
+                for (Uint8 y = 0; y < 8; ++y) {
+                    blobs.set(x, y, board.get(x, y));
+                }
+            }
+            table.clear();
+            SearchContext context(
+                config, NULL, &table, NULL, NULL, NULL, evaluator, network);
+            context.quiet = true;
+            Strategy s(blobs, holes, side, context);
+            s.setSeed(rng());
+
+            movement mv;
+            if (ply < randomPlies) {
+                vector<movement> moves;
+                s.computeValidMoves(moves);
+                mv = moves[rng() % moves.size()];
+            } else {
+                result.push_back({board.blobs[side],
+                                  board.blobs[side ^ 1],
+                                  board.holes,
+                                  0,
+                                  {0}});
+                players.push_back(side);
+                s.computeBestMove();
+                if (!context.hasBestMove) {
+                    break;
+                }
+                mv = context.bestMove;
+            }
+            board.apply(side, mv);
+            side ^= 1;
+        }
+
+        Sint32 difference = (Sint32)board.score(0) - (Sint32)board.score(1);
+        Sint8 winner = difference > 0 ? 1 : difference < 0 ? -1 : 0;
+        for (Uint32 i = 0; i < result.size(); ++i) {
+            result[i].result = players[i] == 0 ? winner : -winner;
+        }
+        return result;
+    }
+
+   public:
+    samplePlayer(const EngineConfig& config,
+                 const PatternEvaluator* evaluator,
+                 const NetworkEvaluator* network,
+                 const vector<bidiarray<bool>>& maps,
+                 Uint32 games,
+                 Uint32 randomPlies,
+                 Uint32 seed,
+                 ofstream& outfile)
+        : config(config),
+          evaluator(evaluator),
+          network(network),
+          maps(maps),
+          games(games),
+          randomPlies(randomPlies),
+          seed(seed),
+          outfile(outfile) {}
+
+    //! thread playing games until all are played
+    void run() {
+        TranspositionTable table(config.ttSize);
+        Uint32 game;
+        while ((game = next++) < games) {
+            vector<trainingSample> result = play(game, table);
+
+            lock_guard<mutex> lock(output);
+            outfile.write((const char*)result.data(),
+                          result.size() * sizeof(trainingSample));
+            samples += result.size();
+            ++played;
+            if (played % 50 == 0 || played == games) {
+                printf("%u games, %llu samples\n",
+                       played,
+                       (unsigned long long)samples);
+                fflush(stdout);
+            }
+        }
+    }
+};
+
+//! result of a sample as a probability of winning
+static inline double target(const trainingSample& s) {
+    return (s.result + 1) / 2.0;
+}
+
+//! run f(first, last, thread) on a slice of [0, count[ in each thread
+template <class F>
+static void parallel(size_t count, Uint32 threads, F f) {
+    vector<thread> workers;
+    for (Uint32 t = 0; t < threads; ++t) {
+        workers.push_back(
+            thread(f, count * t / threads, count * (t + 1) / threads, t));
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+//! the samples of a file, mapped read-only
+class sampleFile {
+   private:
+    const trainingSample* samples = NULL;
+    size_t count = 0;
+    //! length of the mapping
+    size_t length = 0;
+
+   public:
+    ~sampleFile() {
+        if (samples != NULL) {
+            munmap((void*)((const sampleHeader*)samples - 1), length);
+        }
+    }
+
+    /**
+     * map the samples of filename, returns false if it is not a sample
+     * file or if its samples are not whole or have a result other than
+     * -1, 0 and 1 (files concatenated with their headers for instance)
+     */
+    bool open(const string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(sampleHeader)) {
+            close(fd);
+            return false;
+        }
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        const sampleHeader* header = (const sampleHeader*)data;
+        length = st.st_size;
+        samples = (const trainingSample*)(header + 1);
+        count = (length - sizeof(sampleHeader)) / sizeof(trainingSample);
+        if (header->magic != SAMPLE_MAGIC ||
+            header->version != SAMPLE_VERSION ||
+            (length - sizeof(sampleHeader)) % sizeof(trainingSample) != 0) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (samples[i].result < -1 || samples[i].result > 1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t size() const { return count; }
+    const trainingSample& operator[](size_t i) const { return samples[i]; }
+};
+
+/**
+ * Fit of the weights of the patterns on samples: logistic regression of
+ * the results on the evaluation (Texel).
+ * The probability that the player to move wins is taken to be
+ * sigmoid(scale * evaluation), a draw counting as half a win, and the
+ * weights minimise the mean squared error of this prediction.
+ */
+class patternFit {
+   private:
+    const sampleFile& samples;
+    Uint32 threads;
+    //! the weights being fitted
+    vector<double> weights;
+    double scale = 1;
+
+    //! evaluation of a sample with the current weights, and its features
+    double evaluate(const trainingSample& s,
+                    Uint32 indices[PATTERN_FEATURES],
+                    Sint32& material) const {
+        PatternEvaluator::features(s.mine, s.theirs, s.holes, indices);
+        material = (Sint32)cellCount(s.mine) - (Sint32)cellCount(s.theirs);
+        double e = material * weights[PATTERN_MATERIAL];
+        for (Uint32 i = 0; i < PATTERN_FEATURES; ++i) {
+            e += weights[indices[i]];
+        }
+        return e;
+    }
+
+    //! win probability of an evaluation
+    double sigmoid(double evaluation) const {
+        return 1 / (1 + exp(-scale * evaluation));
+    }
+
+   public:
+    patternFit(const sampleFile& samples, Uint32 threads)
+        : samples(samples), threads(max(threads, 1u)) {}
+
+    void setWeights(const vector<Sint16>& w) {
+        weights.assign(w.begin(), w.end());
+    }
+
+    vector<Sint16> roundedWeights() const {
+        vector<Sint16> w(PATTERN_WEIGHTS);
+        for (Uint32 i = 0; i < PATTERN_WEIGHTS; ++i) {
+            w[i] = (Sint16)max(-32767.0, min(32767.0, round(weights[i])));
+        }
+        w[PATTERN_NONE] = 0;
+        return w;
+    }
+
+    //! mean squared error of the predictions
+    double error() const {
+        vector<double> sums(threads, 0);
+        auto errors = [&](size_t first, size_t last, Uint32 t) {
+            Uint32 indices[PATTERN_FEATURES];
+            Sint32 material;
+            double sum = 0;
+            for (size_t i = first; i < last; ++i) {
+                double d = sigmoid(evaluate(samples[i], indices, material)) -
+                           target(samples[i]);
+                sum += d * d;
+            }
+            sums[t] = sum;
+        };
+        parallel(samples.size(), threads, errors);
+        double sum = 0;
+        for (double s : sums) {
+            sum += s;
+        }
+        return sum / samples.size();
+    }
+
+    /**
+     * Choose the scale of the sigmoid which fits the current weights best
+     * (golden section search on its logarithm), returns the error.
+     */
+    double fitScale() {
+        double low = log(1e-4), high = log(1.0);
+        const double ratio = (sqrt(5.0) - 1) / 2;
+        for (Uint32 i = 0; i < 40; ++i) {
+            double a = high - ratio * (high - low);
+            double b = low + ratio * (high - low);
+            scale = exp(a);
+            double errorA = error();
+            scale = exp(b);
+            double errorB = error();
+            if (errorA < errorB) {
+                high = b;
+            } else {
+                low = a;
+            }
+        }
+        scale = exp((low + high) / 2);
+        return error();
+    }
+
+    double sigmoidScale() const { return scale; }
+
+    /**
+     * Fit the weights with iterations steps of Adam on the gradient of all
+     * the samples, computed by slices in every thread.
+     */
+    void fitWeights(Uint32 iterations) {
+        vector<vector<double>> gradients(threads,
+                                         vector<double>(PATTERN_WEIGHTS));
+        vector<double> m(PATTERN_WEIGHTS, 0), v(PATTERN_WEIGHTS, 0);
+        const double beta1 = 0.9, beta2 = 0.999;
+
+        for (Uint32 it = 1; it <= iterations; ++it) {
+            auto gradient = [&](size_t first, size_t last, Uint32 t) {
+                vector<double>& g = gradients[t];
+                fill(g.begin(), g.end(), 0);
+                Uint32 indices[PATTERN_FEATURES];
+                Sint32 material;
+                for (size_t i = first; i < last; ++i) {
+                    double p = sigmoid(evaluate(samples[i], indices, material));
+                    double d =
+                        2 * (p - target(samples[i])) * p * (1 - p) * scale;
+                    g[PATTERN_MATERIAL] += d * material;
+                    for (Uint32 f = 0; f < PATTERN_FEATURES; ++f) {
+                        g[indices[f]] += d;
+                    }
+                }
+            };
+            parallel(samples.size(), threads, gradient);
+
+            for (Uint32 w = PATTERN_MATERIAL; w < PATTERN_WEIGHTS; ++w) {
+                double g = 0;
+                for (Uint32 t = 0; t < threads; ++t) {
+                    g += gradients[t][w];
+                }
+                g /= samples.size();
+                if (w != PATTERN_MATERIAL) {
+                    g += 2 * REGULARIZATION * weights[w];
+                }
+                m[w] = beta1 * m[w] + (1 - beta1) * g;
+                v[w] = beta2 * v[w] + (1 - beta2) * g * g;
+                double mHat = m[w] / (1 - pow(beta1, it));
+                double vHat = v[w] / (1 - pow(beta2, it));
+                weights[w] -= LEARNING_RATE * mHat / (sqrt(vHat) + 1e-12);
+            }
+
+            if (it % 50 == 0 || it == iterations) {
+                printf("iteration %u: error %.6f\n", it, error());
+                fflush(stdout);
+            }
+        }
+    }
+};
+
+/*
+ * Parameters of the network being trained, in floats, at these offsets of
+ * a single vector (and so are their gradients): see NetworkWeights.
+ */
+#define PARAMETER_INPUT 0
+#define PARAMETER_INPUT_BIAS (NETWORK_INPUTS * NETWORK_HIDDEN)
+#define PARAMETER_LAYER (PARAMETER_INPUT_BIAS + NETWORK_HIDDEN)
+#define PARAMETER_LAYER_BIAS \
+    (PARAMETER_LAYER + NETWORK_LAYER * 2 * NETWORK_HIDDEN)
+#define PARAMETER_OUTPUT (PARAMETER_LAYER_BIAS + NETWORK_LAYER)
+#define PARAMETER_OUTPUT_BIAS (PARAMETER_OUTPUT + NETWORK_LAYER)
+#define PARAMETERS (PARAMETER_OUTPUT_BIAS + 1)
+
+/**
+ * Training of the network on samples, for the same prediction as the
+ * patterns: sigmoid(scale * evaluation) is the probability that the
+ * player to move wins.
+ * The network is trained in floats by minibatches (the gradient of each
+ * one summed by slices in every thread, then a step of Adam) and
+ * quantized at the end. The weights of the second layer are kept in the
+ * range of their 8 bits. The last samples are kept out of the training to
+ * measure its error on positions it has not seen.
+ */
+class networkFit {
+   private:
+    const sampleFile& samples;
+    Uint32 threads;
+    //! scale of the sigmoid, per blob (the network outputs blobs)
+    double scale;
+    vector<float> parameters;
+    //! samples [0, training[ are trained on, the others validate
+    size_t training;
+
+    //! activations of the network for a sample
+    struct activations {
+        //! active inputs of each point of view
+        Uint32 inputs[2][NETWORK_INPUTS];
+        Uint32 active[2];
+        //! first layer, by point of view, before and after clipping
+        float first[2][NETWORK_HIDDEN];
+        float clipped[2 * NETWORK_HIDDEN];
+        //! second layer
+        float second[NETWORK_LAYER];
+        float hidden[NETWORK_LAYER];
+        float output;
+    };
+
+    static float clip(float x) { return x < 0 ? 0 : x > 1 ? 1 : x; }
+
+    //! output of the network for s (in blobs, with the blob difference),
+    //! and its activations
+    void forward(const trainingSample& s, activations& a) const {
+        const float* p = parameters.data();
+        for (Uint32 view = 0; view < 2; ++view) {
+            Uint64 planes[3] = {view == 0 ? s.mine : s.theirs,
+                                view == 0 ? s.theirs : s.mine,
+                                s.holes};
+            Uint32 n = 0;
+            for (Uint32 plane = 0; plane < 3; ++plane) {
+                for (Uint64 cells = planes[plane]; cells; cells &= cells - 1) {
+                    a.inputs[view][n++] = plane * 64 + firstCell(cells);
+                }
+            }
+            a.active[view] = n;
+
+            float* first = a.first[view];
+            for (Uint32 h = 0; h < NETWORK_HIDDEN; ++h) {
+                first[h] = p[PARAMETER_INPUT_BIAS + h];
+            }
+            for (Uint32 i = 0; i < n; ++i) {
+                const float* row =
+                    p + PARAMETER_INPUT + a.inputs[view][i] * NETWORK_HIDDEN;
+                for (Uint32 h = 0; h < NETWORK_HIDDEN; ++h) {
+                    first[h] += row[h];
+                }
+            }
+            for (Uint32 h = 0; h < NETWORK_HIDDEN; ++h) {
+                a.clipped[view * NETWORK_HIDDEN + h] = clip(first[h]);
+            }
+        }
+
+        a.output = p[PARAMETER_OUTPUT_BIAS] + (float)cellCount(s.mine) -
+                   (float)cellCount(s.theirs);
+        for (Uint32 n = 0; n < NETWORK_LAYER; ++n) {
+            const float* row = p + PARAMETER_LAYER + n * 2 * NETWORK_HIDDEN;
+            float sum = p[PARAMETER_LAYER_BIAS + n];
+            for (Uint32 i = 0; i < 2 * NETWORK_HIDDEN; ++i) {
+                sum += row[i] * a.clipped[i];
+            }
+            a.second[n] = sum;
+            a.hidden[n] = clip(sum);
+            a.output += p[PARAMETER_OUTPUT + n] * a.hidden[n];
+        }
+    }
+
+    //! add the gradient of the error of a sample whose prediction is off
+    //! by d (the derivative of the error by the output) to g
+    void backward(const activations& a, float d, float* g) const {
+        const float* p = parameters.data();
+        float clipped[2 * NETWORK_HIDDEN] = {0};
+        g[PARAMETER_OUTPUT_BIAS] += d;
+        for (Uint32 n = 0; n < NETWORK_LAYER; ++n) {
+            g[PARAMETER_OUTPUT + n] += d * a.hidden[n];
+            if (a.second[n] <= 0 || a.second[n] >= 1) {
+                continue;
+            }
+            float dn = d * p[PARAMETER_OUTPUT + n];
+            g[PARAMETER_LAYER_BIAS + n] += dn;
+            const float* row = p + PARAMETER_LAYER + n * 2 * NETWORK_HIDDEN;
+            float* gRow = g + PARAMETER_LAYER + n * 2 * NETWORK_HIDDEN;
+            for (Uint32 i = 0; i < 2 * NETWORK_HIDDEN; ++i) {
+                gRow[i] += dn * a.clipped[i];
+                clipped[i] += dn * row[i];
+            }
+        }
+
+        for (Uint32 view = 0; view < 2; ++view) {
+            float first[NETWORK_HIDDEN];
+            for (Uint32 h = 0; h < NETWORK_HIDDEN; ++h) {
+                float x = a.first[view][h];
+                first[h] =
+                    x > 0 && x < 1 ? clipped[view * NETWORK_HIDDEN + h] : 0;
+                g[PARAMETER_INPUT_BIAS + h] += first[h];
+            }
+            for (Uint32 i = 0; i < a.active[view]; ++i) {
+                float* gRow =
+                    g + PARAMETER_INPUT + a.inputs[view][i] * NETWORK_HIDDEN;
+                for (Uint32 h = 0; h < NETWORK_HIDDEN; ++h) {
+                    gRow[h] += first[h];
+                }
+            }
+        }
+    }
+
+    //! mean squared error of the predictions of samples [first, last[
+    double error(size_t first, size_t last) const {
+        vector<double> sums(threads, 0);
+        auto errors = [&](size_t begin, size_t end, Uint32 t) {
+            activations a;
+            double sum = 0;
+            for (size_t i = first + begin; i < first + end; ++i) {
+                forward(samples[i], a);
+                double d =
+                    1 / (1 + exp(-scale * a.output)) - target(samples[i]);
+                sum += d * d;
+            }
+            sums[t] = sum;
+        };
+        parallel(last - first, threads, errors);
+        double sum = 0;
+        for (double s : sums) {
+            sum += s;
+        }
+        return sum / max(last - first, (size_t)1);
+    }
+
+   public:
+    networkFit(const sampleFile& samples, Uint32 threads, double scale)
+        : samples(samples),
+          threads(max(threads, 1u)),
+          scale(scale * NETWORK_SCALE),
+          parameters(PARAMETERS, 0),
+          training(samples.size() - samples.size() / NETWORK_VALIDATION) {
+        // small random weights, the neurons starting in the middle of
+        // their range
+        default_random_engine rng(0);
+        uniform_real_distribution<float> input(-0.1, 0.1);
+        uniform_real_distribution<float> layer(-0.15, 0.15);
+        uniform_real_distribution<float> output(-0.5, 0.5);
+        for (Uint32 i = 0; i < NETWORK_INPUTS * NETWORK_HIDDEN; ++i) {
+            parameters[PARAMETER_INPUT + i] = input(rng);
+        }
+        for (Uint32 h = 0; h < NETWORK_HIDDEN; ++h) {
+            parameters[PARAMETER_INPUT_BIAS + h] = 0.5;
+        }
+        for (Uint32 i = 0; i < NETWORK_LAYER * 2 * NETWORK_HIDDEN; ++i) {
+            parameters[PARAMETER_LAYER + i] = layer(rng);
+        }
+        for (Uint32 n = 0; n < NETWORK_LAYER; ++n) {
+            parameters[PARAMETER_LAYER_BIAS + n] = 0.5;
+            parameters[PARAMETER_OUTPUT + n] = output(rng);
+        }
+    }
+
+    size_t trainingSamples() const { return training; }
+
+    /**
+     * Train the network for iterations passes on the training samples, in
+     * a random order, and keep the parameters of the pass with the lowest
+     * error on the validation samples.
+     */
+    void train(Uint32 iterations) {
+        vector<vector<float>> gradients(threads, vector<float>(PARAMETERS));
+        vector<float> m(PARAMETERS, 0), v(PARAMETERS, 0);
+        const double beta1 = 0.9, beta2 = 0.999;
+        // the weights of the second layer stay in 8 bits
+        const float layerMin = -128.0 / NETWORK_WEIGHT_ONE;
+        const float layerMax = 127.0 / NETWORK_WEIGHT_ONE;
+
+        vector<Uint32> order(training);
+        for (Uint32 i = 0; i < training; ++i) {
+            order[i] = i;
+        }
+        default_random_engine rng(1);
+        Uint64 steps = 0;
+        // the parameters of the pass with the lowest validation error
+        vector<float> best = parameters;
+        double bestError = error(training, samples.size());
+
+        for (Uint32 it = 1; it <= iterations; ++it) {
+            shuffle(order.begin(), order.end(), rng);
+            for (size_t batch = 0; batch < training; batch += NETWORK_BATCH) {
+                size_t size = min((size_t)NETWORK_BATCH, training - batch);
+                auto gradient = [&](size_t first, size_t last, Uint32 t) {
+                    float* g = gradients[t].data();
+                    fill(g, g + PARAMETERS, 0);
+                    activations a;
+                    for (size_t i = batch + first; i < batch + last; ++i) {
+                        const trainingSample& s = samples[order[i]];
+                        forward(s, a);
+                        double p = 1 / (1 + exp(-scale * a.output));
+                        double d = 2 * (p - target(s)) * p * (1 - p) * scale;
+                        backward(a, d, g);
+                    }
+                };
+                parallel(size, threads, gradient);
+
+                ++steps;
+                double correction1 = 1 - pow(beta1, steps);
+                double correction2 = 1 - pow(beta2, steps);
+                for (Uint32 w = 0; w < PARAMETERS; ++w) {
+                    double g = 0;
+                    for (Uint32 t = 0; t < threads; ++t) {
+                        g += gradients[t][w];
+                    }
+                    g /= size;
+                    m[w] = beta1 * m[w] + (1 - beta1) * g;
+                    v[w] = beta2 * v[w] + (1 - beta2) * g * g;
+                    parameters[w] -= NETWORK_LEARNING_RATE *
+                                     (m[w] / correction1) /
+                                     (sqrt(v[w] / correction2) + 1e-8);
+                }
+                for (Uint32 i = PARAMETER_LAYER; i < PARAMETER_LAYER_BIAS;
+                     ++i) {
+                    float& w = parameters[i];
+                    w = max(layerMin, min(layerMax, w));
+                }
+            }
+            double validation = error(training, samples.size());
+            printf("iteration %u: error %.6f, validation %.6f\n",
+                   it,
+                   error(0, training),
+                   validation);
+            fflush(stdout);
+            if (validation < bestError) {
+                bestError = validation;
+                best = parameters;
+            }
+        }
+        // the network learns the games by heart after a while
+        parameters = best;
+    }
+
+    //! the weights rounded to those of the engine
+    NetworkWeights quantizedWeights() const {
+        const float* p = parameters.data();
+        auto quantize = [](double x, double one, double bound) {
+            return max(-bound, min(bound, round(x * one)));
+        };
+        const double activation = NETWORK_ONE;
+        const double product = NETWORK_ONE * NETWORK_WEIGHT_ONE;
+        NetworkWeights w;
+        for (Uint32 i = 0; i < NETWORK_INPUTS; ++i) {
+            for (Uint32 h = 0; h < NETWORK_HIDDEN; ++h) {
+                w.input[i][h] =
+                    quantize(p[PARAMETER_INPUT + i * NETWORK_HIDDEN + h],
+                             activation,
+                             32767);
+            }
+        }
+        for (Uint32 h = 0; h < NETWORK_HIDDEN; ++h) {
+            w.inputBias[h] =
+                quantize(p[PARAMETER_INPUT_BIAS + h], activation, 32767);
+        }
+        for (Uint32 n = 0; n < NETWORK_LAYER; ++n) {
+            for (Uint32 i = 0; i < 2 * NETWORK_HIDDEN; ++i) {
+                w.layer[n][i] =
+                    quantize(p[PARAMETER_LAYER + n * 2 * NETWORK_HIDDEN + i],
+                             NETWORK_WEIGHT_ONE,
+                             127);
+            }
+            w.layerBias[n] =
+                quantize(p[PARAMETER_LAYER_BIAS + n], product, 1e9);
+            w.output[n] =
+                quantize(p[PARAMETER_OUTPUT + n], NETWORK_WEIGHT_ONE, 32767);
+        }
+        w.outputBias = quantize(p[PARAMETER_OUTPUT_BIAS], product, 1e9);
+        return w;
+    }
+
+    //! mean squared error of the validation samples with network, whose
+    //! evaluations are in points
+    double validationError(const NetworkEvaluator& network) const {
+        double sum = 0;
+        for (size_t i = training; i < samples.size(); ++i) {
+            const trainingSample& s = samples[i];
+            double points = network.evaluate(s.mine, s.theirs, s.holes);
+            double p = 1 / (1 + exp(-scale / NETWORK_SCALE * points));
+            double d = p - target(s);
+            sum += d * d;
+        }
+        return sum / max(samples.size() - training, (size_t)1);
+    }
+};
+
+//! open filename to append samples, writing the header if it is new
+static bool openSamples(const string& filename, ofstream& outfile) {
+    struct stat st;
+    bool exists = stat(filename.c_str(), &st) == 0 && st.st_size != 0;
+    outfile.open(filename.c_str(), ios::out | ios::binary | ios::app);
+    if (!outfile) {
+        cerr << "unable to write " << filename << endl;
+        return false;
+    }
+    if (!exists) {
+        sampleHeader header = {SAMPLE_MAGIC, SAMPLE_VERSION, 0};
+        outfile.write((const char*)&header, sizeof(header));
+    }
+    return true;
+}
+
+//! play games self-play games into filename (appended if it exists)
+static int generateSamples(const string& filename,
+                           const EngineConfig& config,
+                           Uint32 games,
+                           Uint32 randomPlies,
+                           Uint32 seed,
+                           Uint32 threads) {
+    vector<bidiarray<bool>> maps;
+    for (auto& name : listMaps()) {
+        bidiarray<bool> holes;
+        if (!loadMap(MAPS_DIRECTORY + name, holes)) {
+            cerr << "unable to load map " << name << endl;
+            return 1;
+        }
+        maps.push_back(holes);
+    }
+    if (maps.empty()) {
+        cerr << "no maps in " << MAPS_DIRECTORY << endl;
+        return 1;
+    }
+
+    ofstream outfile;
+    if (!openSamples(filename, outfile)) {
+        return 1;
+    }
+
+    PatternEvaluator patterns;
+    NetworkEvaluator network;
+    samplePlayer player(config,
+                        loadEvaluator(config, patterns),
+                        loadNetwork(config, network),
+                        maps,
+                        games,
+                        randomPlies,
+                        seed,
+                        outfile);
+    vector<thread> workers;
+    for (Uint32 t = 0; t < max(threads, 1u); ++t) {
+        workers.push_back(thread(&samplePlayer::run, &player));
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    return outfile ? 0 : 1;
+}
+
+//! append the samples of the files inputs to filename
+static int mergeSamples(const string& filename, const vector<string>& inputs) {
+    ofstream outfile;
+    if (!openSamples(filename, outfile)) {
+        return 1;
+    }
+    for (auto& name : inputs) {
+        sampleFile samples;
+        if (!samples.open(name)) {
+            cerr << "unable to read the samples of " << name << endl;
+            return 1;
+        }
+        outfile.write((const char*)&samples[0],
+                      samples.size() * sizeof(trainingSample));
+        printf("%zu samples of %s\n", samples.size(), name.c_str());
+    }
+    return outfile ? 0 : 1;
+}
+
+//! fit the weights of the patterns on samples, starting from those of
+//! config, and write them to weightsname
+static int fitPatterns(const sampleFile& samples,
+                       const EngineConfig& config,
+                       const string& weightsname,
+                       Uint32 iterations,
+                       Uint32 threads) {
+    patternFit fit(samples, threads);
+    PatternEvaluator patterns;
+    if (patterns.load(config.weights)) {
+        printf("starting from the weights of %s\n", config.weights.c_str());
+    }
+    fit.setWeights(patterns.weights());
+
+    double error = fit.fitScale();
+    printf("sigmoid scale %.6f per point, error %.6f\n",
+           fit.sigmoidScale(),
+           error);
+    fit.fitWeights(iterations);
+
+    patterns.setWeights(fit.roundedWeights());
+    if (!patterns.write(weightsname)) {
+        cerr << "unable to write " << weightsname << endl;
+        return 1;
+    }
+    printf("material: %d points per blob, weights written to %s\n",
+           patterns.weights()[PATTERN_MATERIAL],
+           weightsname.c_str());
+    return 0;
+}
+
+//! train a network on samples and write it to networkname
+static int fitNetwork(const sampleFile& samples,
+                      const string& networkname,
+                      Uint32 iterations,
+                      Uint32 threads) {
+    // the scale of the sigmoid is the one of material, the network is not
+    // asked to predict the results more sharply
+    patternFit material(samples, threads);
+    material.setWeights(PatternEvaluator().weights());
+    double error = material.fitScale();
+    printf("sigmoid scale %.6f per point, error of material %.6f\n",
+           material.sigmoidScale(),
+           error);
+
+    networkFit fit(samples, threads, material.sigmoidScale());
+    printf("%zu training samples\n", fit.trainingSamples());
+    fit.train(iterations);
+
+    NetworkEvaluator network;
+    network.setWeights(fit.quantizedWeights());
+    printf("validation error once quantized: %.6f\n",
+           fit.validationError(network));
+    if (!network.write(networkname)) {
+        cerr << "unable to write " << networkname << endl;
+        return 1;
+    }
+    printf("network written to %s\n", networkname.c_str());
+    return 0;
+}
+
+//! fit the evaluation of config on the samples of filename
+static int fitSamples(const string& filename,
+                      const EngineConfig& config,
+                      const string& out,
+                      Uint32 iterations,
+                      Uint32 threads) {
+    sampleFile samples;
+    if (!samples.open(filename)) {
+        cerr << "unable to read the samples of " << filename << endl;
+        return 1;
+    }
+    printf("%zu samples\n", samples.size());
+    if (config.evaluation == "network") {
+        return fitNetwork(samples,
+                          out.empty() ? NETWORK_FILE : out,
+                          iterations != 0 ? iterations : NETWORK_ITERATIONS,
+                          threads);
+    }
+    return fitPatterns(samples,
+                       config,
+                       out.empty() ? PATTERN_WEIGHTS_FILE : out,
+                       iterations != 0 ? iterations : DEFAULT_ITERATIONS,
+                       threads);
+}
+
+/** Main of tuneEval
+ * Tunes the weights of the evaluations of the leaves: -generate plays
+ * self-play games with the engine options and appends each position with
+ * the result of its game to a sample file, -fit fits the weights of the
+ * patterns (see PatternEvaluator) on a sample file by logistic regression,
+ * or trains the network (see NetworkEvaluator) with -eval network, and
+ * writes the weight file the engines load (-weights gives the starting
+ * weights of the patterns). -merge appends the samples of other sample
+ * files to one.
+ */
+int main(int argc, char** argv) {
+    string generate, fitname, merge, out;
+    vector<string> inputs;
+    Uint32 games = DEFAULT_GAMES;
+    Uint32 randomPlies = DEFAULT_RANDOM_PLIES;
+    Uint32 seed = 0;
+    Uint32 iterations = 0;
+    Uint32 threads = thread::hardware_concurrency();
+
+    EngineConfig config;
+    config.algorithm = "alphabeta";
+    config.ttSize = 16;
+    config.depth = 2;
+    // the solver has no time budget and some positions take it minutes,
+    // the samples do not need perfect endgames
+    config.endgame = 0;
+    config.book = false;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "-generate") == 0 && hasValue) {
+            generate = argv[++i];
+        } else if (strcmp(argv[i], "-fit") == 0 && hasValue) {
+            fitname = argv[++i];
+        } else if (strcmp(argv[i], "-merge") == 0 && hasValue) {
+            merge = argv[++i];
+            while (i + 1 < argc && argv[i + 1][0] != '-') {
+                inputs.push_back(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "-out") == 0 && hasValue) {
+            out = argv[++i];
+        } else if (strcmp(argv[i], "-games") == 0 && hasValue) {
+            games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-random") == 0 && hasValue) {
+            randomPlies = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-seed") == 0 && hasValue) {
+            seed = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-iterations") == 0 && hasValue) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-jobs") == 0 && hasValue) {
+            threads = atoi(argv[++i]);
+        } else if (argv[i][0] != '-' || !hasValue ||
+                   !setEngineOption(config, argv[i] + 1, argv[i + 1])) {
+            generate.clear();
+            fitname.clear();
+            merge.clear();
+            break;
+        } else {
+            ++i;
+        }
+    }
+    if (!generate.empty() + !fitname.empty() + !merge.empty() != 1 ||
+        (!merge.empty() && inputs.empty())) {
+        printf("usage: ./tuneEval -generate samples [-games n] [-random n] "
+               "[-seed n] [options]\n");
+        printf("       ./tuneEval -fit samples [-eval network] [-out weights] "
+               "[-iterations n] [-weights start]\n");
+        printf("       ./tuneEval -merge samples other... (appends the "
+               "samples of the other files)\n");
+        printf("	-games <n> self-play games (default: %d).\n",
+               DEFAULT_GAMES);
+        printf("	-random <n> plies played at random first (default: "
+               "%d).\n",
+               DEFAULT_RANDOM_PLIES);
+        printf("	-seed <n> seed of the games, to add other games to a "
+               "sample file (default: 0).\n");
+        printf("	-out <file> weights written (default: %s, or %s for the "
+               "network).\n",
+               PATTERN_WEIGHTS_FILE,
+               NETWORK_FILE);
+        printf("	-iterations <n> passes on the samples (default: %d, or %d "
+               "for the network).\n",
+               DEFAULT_ITERATIONS,
+               NETWORK_ITERATIONS);
+        printf("	-jobs <n> threads (default: number of cores).\n");
+        printf(
+            "	engine options of the games (default: -algo alphabeta -tt "
+            "16 -depth 2 -endgame 0 -book 0):\n");
+        displayEngineUsage();
+        return 1;
+    }
+    // the games are played at fixed depth
+    config.time = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    int status = !generate.empty()
+                     ? generateSamples(
+                           generate, config, games, randomPlies, seed, threads)
+                 : !merge.empty()
+                     ? mergeSamples(merge, inputs)
+                     : fitSamples(fitname, config, out, iterations, threads);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    printf("done in %.1f s\n", elapsed.count());
+    return status;
+}